@@ -13,7 +13,7 @@ NC='\033[0m' # No Color
 echo -e "${BLUE}Installing Sig Language Compiler...${NC}"
 
 # Check if sig executable exists
-if [ ! -f "./sig" ]; then
+if [ ! -f "./sig" ] || [ ! -f "./libsig_runtime.a" ]; then
     echo -e "${RED}Error: sig executable not found. Please build first:${NC}"
     echo "   ./build.sh"
     exit 1
@@ -36,6 +36,14 @@ echo -e "${BLUE}Installing to: ${INSTALL_DIR}${NC}"
 cp ./sig "$INSTALL_DIR/sig"
 chmod +x "$INSTALL_DIR/sig"
 
+# Programs are linked against the runtime archives, looked up in ../lib/sig
+RUNTIME_DIR="$INSTALL_DIR/../lib/sig"
+mkdir -p "$RUNTIME_DIR"
+cp ./libsig_runtime*.a "$RUNTIME_DIR/"
+if [ -f "./sig_runtime.bc" ]; then
+    cp ./sig_runtime.bc "$RUNTIME_DIR/"
+fi
+
 echo -e "${GREEN}Sig compiler installed successfully!${NC}"
 
 # Check if install directory is in PATH
@@ -1,20 +1,35 @@
 #include "args.hpp"
+#include "version.hpp"
 #include <iostream>
+#include <cstdlib>
 
 void print_help(const char* program_name) {
-    std::cout << "Sig Language Compiler v0.2.0-alpha\n";
+    std::cout << "Sig Language Compiler v" << sig_version << "\n";
     std::cout << "A modern systems programming language powered by LLVM\n\n";
     std::cout << "USAGE:\n";
-    std::cout << "    " << program_name << " <file.sg> [OPTIONS]\n\n";
+    std::cout << "    " << program_name << " <file.sg> [OPTIONS]\n";
+    std::cout << "    " << program_name << " - [OPTIONS]           (read program from stdin)\n\n";
     std::cout << "COMPILATION MODES:\n";
     std::cout << "    (default)      Compile to executable\n";
     std::cout << "    --jit          Execute with LLVM JIT\n";
+    std::cout << "    --jit-lazy     Execute with LLVM JIT, compiling each function on first call\n";
+    std::cout << "    --jit-tiered   Execute with LLVM JIT at -O0, recompiling hot functions at -O3\n";
     std::cout << "    --ir           Display generated LLVM IR\n";
 
     std::cout << "OPTIONS:\n";
     std::cout << "    -o <name>      Output name (executable or .o for object file)\n";
+    std::cout << "    -O0 .. -O3     Optimization level (default: -O0)\n";
+    std::cout << "    -Os            Optimize for size\n";
     std::cout << "    -m32           Target 32-bit architecture\n";
+    std::cout << "    -march=<cpu>   Generate code for <cpu> (\"native\" for this machine)\n";
+    std::cout << "    -mattr=<list>  Enable/disable CPU features, e.g. +avx2,-fma\n";
+    std::cout << "    --jit-threads <n>  Compile JIT code on <n> background threads\n";
+    std::cout << "    --jit-tier-threshold <n>  Calls before --jit-tiered recompiles a function (default: 1000)\n";
+    std::cout << "    --jit-stats    Report per-function tier-up statistics after --jit-tiered\n";
     std::cout << "    --no-std       Disable standard library (for OS/kernel development)\n";
+    std::cout << "    --cache-dir <dir>  Cache parsed modules and JIT objects in <dir> (default: ~/.cache/sig)\n";
+    std::cout << "    --no-cache     Do not read or write the caches\n";
+    std::cout << "    --cache-stats  Report cache hits and misses\n";
     std::cout << "    -h, --help     Show this help message\n";
     std::cout << "    -v, --version  Show version information\n\n";
     std::cout << "EXAMPLES:\n";
@@ -22,17 +37,22 @@ void print_help(const char* program_name) {
     std::cout << "    " << program_name << " hello.sg -o myprogram       # Creates 'myprogram' executable\n";
     std::cout << "    " << program_name << " hello.sg -o hello.o         # Creates 'hello.o' object file\n";
     std::cout << "    " << program_name << " program.sg --jit            # Execute with JIT\n";
+    std::cout << "    " << program_name << " program.sg -O2              # Optimized executable\n";
     std::cout << "    " << program_name << " program.sg --ir             # Show LLVM IR\n\n";
     std::cout << "For more information, visit: https://github.com/GhostedGaming/sig-language\n";
 }
 
 void print_version() {
-    std::cout << "Sig Language Compiler v0.2.0-alpha\n";
+    std::cout << "Sig Language Compiler v" << sig_version << "\n";
     std::cout << "Built with LLVM backend for cross-platform compilation\n";
     std::cout << "Copyright (c) 2024 - Licensed under MIT\n";
 }
 
 std::string get_default_output_name(const std::string& input_file) {
+    if (input_file == "-") {
+        return "a.out";
+    }
+    
     size_t last_slash = input_file.find_last_of("/\\");
     size_t start = (last_slash == std::string::npos) ? 0 : last_slash + 1;
     
@@ -78,15 +98,74 @@ CompilerArgs parse_args(int argc, char* argv[]) {
         else if (arg == "--jit") {
             args.mode = "jit";
         }
+        else if (arg == "--jit-lazy") {
+            args.mode = "jit";
+            args.lazy_jit = true;
+        }
+        else if (arg == "--jit-threads") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --jit-threads requires a thread count\n";
+                args.show_help = true;
+                return args;
+            }
+            args.jit_threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--jit-tiered") {
+            args.mode = "jit";
+            args.tiered_jit = true;
+        }
+        else if (arg == "--jit-tier-threshold") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --jit-tier-threshold requires a call count\n";
+                args.show_help = true;
+                return args;
+            }
+            args.tier_threshold = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--jit-stats") {
+            args.jit_stats = true;
+        }
         else if (arg == "--ir") {
             args.mode = "ir";
         }
         else if (arg == "-m32") {
             args.target_32bit = true;
         }
+        else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' && arg[2] <= '3') {
+            args.opt_level = arg[2] - '0';
+            args.optimize_size = false;
+        }
+        else if (arg == "-Os") {
+            args.opt_level = 2;
+            args.optimize_size = true;
+        }
+        else if (arg.rfind("-march=", 0) == 0) {
+            args.target_cpu = arg.substr(7);
+        }
+        else if (arg.rfind("-mattr=", 0) == 0) {
+            args.target_features = arg.substr(7);
+        }
         else if (arg == "--no-std") {
             args.no_std = true;
         }
+        else if (arg == "--cache-dir") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --cache-dir requires a directory\n";
+                args.show_help = true;
+                return args;
+            }
+            args.cache_dir = argv[++i];
+        }
+        else if (arg == "--no-cache") {
+            args.no_cache = true;
+        }
+        else if (arg == "--cache-stats") {
+            args.cache_stats = true;
+        }
+        else if (arg == "-" && args.input_file.empty()) {
+            // Read the program from stdin
+            args.input_file = arg;
+        }
         else if (arg[0] == '-') {
             std::cerr << "Error: Unknown option " << arg << "\n";
             args.show_help = true;
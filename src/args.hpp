@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
 struct CompilerArgs {
@@ -10,6 +11,18 @@ struct CompilerArgs {
     bool target_32bit = false;
     bool object_only = false;
     bool no_std = false;
+    bool lazy_jit = false;      // --jit-lazy
+    unsigned jit_threads = 0;   // --jit-threads <n>
+    bool tiered_jit = false;    // --jit-tiered
+    uint64_t tier_threshold = 0; // --jit-tier-threshold <n>, 0: TieredJIT::default_threshold
+    bool jit_stats = false;     // --jit-stats
+    unsigned opt_level = 0;     // -O0..-O3
+    bool optimize_size = false; // -Os
+    std::string target_cpu;     // -march=<cpu>, "native" for the host
+    std::string target_features; // -mattr=<+feat,-feat,...>
+    std::string cache_dir;      // empty: ParseCache::default_directory()
+    bool no_cache = false;
+    bool cache_stats = false;
 };
 
 CompilerArgs parse_args(int argc, char* argv[]);
@@ -0,0 +1,166 @@
+#include "../public/ast_simple.hpp"
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+void NodeRef::too_large() {
+    std::cerr << "Error: AST too large - a program is limited to " << (index_mask + 1)
+              << " statements of each kind" << std::endl;
+    std::exit(1);
+}
+
+// Rewrites the references inside a node moved from another arena: pool
+// indices and list ranges shift by the size this arena had before the
+// move, and symbols are re-interned into this arena's table.
+struct AstArena::Relocation {
+    std::vector<Symbol> symbols;
+    std::array<uint32_t, kind_count> node_offsets{};
+    uint32_t block_offset = 0;
+    uint32_t symbol_list_offset = 0;
+    uint32_t expression_list_offset = 0;
+    uint32_t elif_offset = 0;
+    uint32_t typed_name_offset = 0;
+    uint32_t expression_offset = 0;
+
+    void apply(Symbol& symbol) const { symbol = symbols[symbol.id]; }
+    void apply(NodeRef& ref) const {
+        ref = NodeRef::make(ref.kind(), ref.index() + node_offsets[static_cast<size_t>(ref.kind())]);
+    }
+    void apply(Range<NodeRef>& range) const { range.first += block_offset; }
+    void apply(Range<Symbol>& range) const { range.first += symbol_list_offset; }
+    void apply(Range<Expression>& range) const { range.first += expression_list_offset; }
+    void apply(Range<ElifClause>& range) const { range.first += elif_offset; }
+    void apply(Range<TypedName>& range) const { range.first += typed_name_offset; }
+    template <typename T>
+    void apply(std::optional<T>& value) const {
+        if (value) apply(*value);
+    }
+    void apply(ExprRef& ref) const { ref.index += expression_offset; }
+    void apply(Expression& expr) const {
+        if (auto* symbol = std::get_if<Symbol>(&expr)) apply(*symbol);
+        if (auto* ref = std::get_if<ExprRef>(&expr)) apply(*ref);
+    }
+    void apply(ExprNode& node) const {
+        apply(node.name);
+        apply(node.field);
+        apply(node.left);
+        apply(node.right);
+        apply(node.elements);
+        apply(node.fields);
+    }
+    void apply(TypedName& node) const {
+        apply(node.name);
+        apply(node.record);
+    }
+
+    void apply(ReturnStatement&) const {}
+    void apply(PrintStatement& node) const { apply(node.value); }
+    void apply(PrintlnStatement& node) const { apply(node.value); }
+    void apply(AsmStatement& node) const { apply(node.value); }
+    void apply(FunctionDefinition& node) const {
+        apply(node.name);
+        apply(node.params);
+        apply(node.body);
+    }
+    void apply(FunctionCall& node) const {
+        apply(node.function_name);
+        apply(node.arguments);
+    }
+    void apply(VariableDeclaration& node) const {
+        apply(node.var_name);
+        apply(node.array.record);
+    }
+    void apply(VariableAssignment& node) const {
+        apply(node.var_name);
+        apply(node.value);
+        apply(node.array.record);
+    }
+    void apply(PrintVariable& node) const { apply(node.variableName); }
+    void apply(ModStatement& node) const { apply(node.filename); }
+    void apply(BinaryExpression& node) const {
+        apply(node.left);
+        apply(node.right);
+    }
+    void apply(UnaryExpression& node) const { apply(node.operand); }
+    void apply(ElifClause& node) const {
+        apply(node.condition);
+        apply(node.block);
+    }
+    void apply(IfStatement& node) const {
+        apply(node.condition);
+        apply(node.thenBlock);
+        apply(node.elifClauses);
+        apply(node.elseBlock);
+    }
+    void apply(WhileStatement& node) const {
+        apply(node.condition);
+        apply(node.body);
+    }
+    void apply(ForStatement& node) const {
+        apply(node.initialization);
+        apply(node.start);
+        apply(node.end);
+        apply(node.body);
+    }
+    void apply(IndexAssignment& node) const {
+        apply(node.array);
+        apply(node.index);
+        apply(node.value);
+    }
+    void apply(FieldAssignment& node) const {
+        apply(node.target);
+        apply(node.index);
+        apply(node.field);
+        apply(node.value);
+    }
+    void apply(StructDefinition& node) const {
+        apply(node.name);
+        apply(node.fields);
+    }
+
+    // Appends `from` to `into` and relocates the appended entries
+    template <typename T>
+    void move_pool(std::vector<T>& into, std::vector<T>& from) const {
+        size_t start = into.size();
+        into.insert(into.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+        from.clear();
+        for (size_t i = start; i < into.size(); ++i) {
+            apply(into[i]);
+        }
+    }
+};
+
+AST AstArena::absorb(AstArena&& other, const AST& roots) {
+    Relocation relocation;
+    relocation.symbols.reserve(other.symbols.size());
+    for (uint32_t id = 0; id < other.symbols.size(); ++id) {
+        relocation.symbols.push_back(symbols.intern(other.symbols.name(Symbol{id})));
+    }
+
+    relocation.block_offset = static_cast<uint32_t>(block_nodes.size());
+    relocation.symbol_list_offset = static_cast<uint32_t>(symbol_lists.size());
+    relocation.expression_list_offset = static_cast<uint32_t>(expression_lists.size());
+    relocation.elif_offset = static_cast<uint32_t>(elif_clauses.size());
+    relocation.typed_name_offset = static_cast<uint32_t>(typed_names.size());
+    relocation.expression_offset = static_cast<uint32_t>(expression_nodes.size());
+
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        ((relocation.node_offsets[I] = static_cast<uint32_t>(std::get<I>(pools).size())), ...);
+        (relocation.move_pool(std::get<I>(pools), std::get<I>(other.pools)), ...);
+    }(std::make_index_sequence<kind_count>{});
+
+    relocation.move_pool(block_nodes, other.block_nodes);
+    relocation.move_pool(symbol_lists, other.symbol_lists);
+    relocation.move_pool(expression_lists, other.expression_lists);
+    relocation.move_pool(elif_clauses, other.elif_clauses);
+    relocation.move_pool(typed_names, other.typed_names);
+    relocation.move_pool(expression_nodes, other.expression_nodes);
+
+    AST relocated(roots);
+    for (NodeRef& ref : relocated) {
+        relocation.apply(ref);
+    }
+    return relocated;
+}
@@ -0,0 +1,348 @@
+#include "../public/ast_simple.hpp"
+#include <cstring>
+#include <utility>
+
+static constexpr uint32_t ast_format_magic = 0x54534153;  // "SAST"
+// Bump whenever a node struct or the encoding below changes
+static constexpr uint32_t ast_format_version = 6;
+
+// Calls f on every stored field of a node, in encoding order
+template <typename Node, typename F>
+static void for_each_field(Node& node, F&& f) {
+    using T = std::remove_const_t<Node>;
+
+    if constexpr (std::is_same_v<T, ReturnStatement> || std::is_same_v<T, PrintStatement> ||
+                  std::is_same_v<T, PrintlnStatement> || std::is_same_v<T, AsmStatement>) {
+        f(node.value);
+    } else if constexpr (std::is_same_v<T, FunctionDefinition>) {
+        f(node.name);
+        f(node.params);
+        f(node.body);
+    } else if constexpr (std::is_same_v<T, FunctionCall>) {
+        f(node.function_name);
+        f(node.arguments);
+    } else if constexpr (std::is_same_v<T, VariableDeclaration>) {
+        f(node.var_name);
+        f(node.type);
+        f(node.array.element);
+        f(node.array.length);
+        f(node.array.record);
+    } else if constexpr (std::is_same_v<T, VariableAssignment>) {
+        f(node.var_name);
+        f(node.value);
+        f(node.type);
+        f(node.array.element);
+        f(node.array.length);
+        f(node.array.record);
+    } else if constexpr (std::is_same_v<T, PrintVariable>) {
+        f(node.variableName);
+    } else if constexpr (std::is_same_v<T, ModStatement>) {
+        f(node.filename);
+    } else if constexpr (std::is_same_v<T, BinaryExpression>) {
+        f(node.left);
+        f(node.operator_type);
+        f(node.right);
+    } else if constexpr (std::is_same_v<T, UnaryExpression>) {
+        f(node.operator_type);
+        f(node.operand);
+    } else if constexpr (std::is_same_v<T, ElifClause>) {
+        f(node.condition);
+        f(node.block);
+    } else if constexpr (std::is_same_v<T, IfStatement>) {
+        f(node.condition);
+        f(node.thenBlock);
+        f(node.elifClauses);
+        f(node.elseBlock);
+    } else if constexpr (std::is_same_v<T, WhileStatement>) {
+        f(node.condition);
+        f(node.body);
+    } else if constexpr (std::is_same_v<T, ForStatement>) {
+        f(node.initialization);
+        f(node.start);
+        f(node.end);
+        f(node.body);
+    } else if constexpr (std::is_same_v<T, IndexAssignment>) {
+        f(node.array);
+        f(node.index);
+        f(node.value);
+    } else if constexpr (std::is_same_v<T, FieldAssignment>) {
+        f(node.target);
+        f(node.index);
+        f(node.field);
+        f(node.value);
+    } else if constexpr (std::is_same_v<T, TypedName>) {
+        f(node.name);
+        f(node.type);
+        f(node.record);
+    } else if constexpr (std::is_same_v<T, StructDefinition>) {
+        f(node.name);
+        f(node.fields);
+        f(node.packed);
+        f(node.align);
+    } else if constexpr (std::is_same_v<T, ExprNode>) {
+        f(node.kind);
+        f(node.op);
+        f(node.name);
+        f(node.field);
+        f(node.left);
+        f(node.right);
+        f(node.elements);
+        f(node.fields);
+        f(node.type);
+        f(node.operand_type);
+    } else {
+        // List entries (NodeRef, Symbol, Expression) are a single field
+        f(node);
+    }
+}
+
+struct AstArena::Writer {
+    std::string& out;
+
+    template <typename T>
+    void raw(T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    void operator()(T value) { raw(value); }
+    template <typename T>
+        requires std::is_enum_v<T>
+    void operator()(T value) { raw(static_cast<std::underlying_type_t<T>>(value)); }
+    void operator()(Symbol symbol) { raw(symbol.id); }
+    void operator()(NodeRef ref) { raw(ref.bits); }
+    void operator()(ExprRef ref) { raw(ref.index); }
+    template <typename T>
+    void operator()(Range<T> range) {
+        raw(range.first);
+        raw(range.count);
+    }
+    template <typename T>
+    void operator()(const std::optional<T>& value) {
+        raw<uint8_t>(value.has_value());
+        if (value) (*this)(*value);
+    }
+    void operator()(const std::string& text) {
+        raw(static_cast<uint32_t>(text.size()));
+        out.append(text);
+    }
+    template <typename... Ts>
+    void operator()(const std::variant<Ts...>& value) {
+        raw(static_cast<uint8_t>(value.index()));
+        std::visit([this](const auto& alternative) { (*this)(alternative); }, value);
+    }
+    void operator()(const TypedValue& value) {
+        (*this)(value.type);
+        (*this)(value.value);
+    }
+
+    template <typename T>
+    void pool(const std::vector<T>& items) {
+        raw(static_cast<uint32_t>(items.size()));
+        for (const T& item : items) {
+            for_each_field(item, *this);
+        }
+    }
+};
+
+struct AstArena::Reader {
+    std::string_view in;
+    size_t pos = 0;
+    bool ok = true;
+
+    template <typename T>
+    T raw() {
+        T value{};
+        if (in.size() - pos < sizeof(T)) {
+            ok = false;
+            pos = in.size();
+            return value;
+        }
+        std::memcpy(&value, in.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    // Element counts are checked against the remaining input before
+    // anything is allocated for them
+    uint32_t count() {
+        uint32_t n = raw<uint32_t>();
+        if (n > in.size() - pos) {
+            ok = false;
+            return 0;
+        }
+        return n;
+    }
+
+    void operator()(bool& value) { value = raw<uint8_t>() != 0; }
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    void operator()(T& value) { value = raw<T>(); }
+    template <typename T>
+        requires std::is_enum_v<T>
+    void operator()(T& value) { value = static_cast<T>(raw<std::underlying_type_t<T>>()); }
+    void operator()(Symbol& symbol) { symbol.id = raw<uint32_t>(); }
+    void operator()(NodeRef& ref) { ref.bits = raw<uint32_t>(); }
+    void operator()(ExprRef& ref) { ref.index = raw<uint32_t>(); }
+    template <typename T>
+    void operator()(Range<T>& range) {
+        range.first = raw<uint32_t>();
+        range.count = raw<uint32_t>();
+    }
+    template <typename T>
+    void operator()(std::optional<T>& value) {
+        if (raw<uint8_t>()) {
+            (*this)(value.emplace());
+        } else {
+            value.reset();
+        }
+    }
+    void operator()(std::string& text) {
+        uint32_t size = count();
+        text.assign(in.substr(pos, size));
+        pos += size;
+    }
+    template <typename Variant, size_t I = 0>
+    void alternative(Variant& value, size_t index) {
+        if constexpr (I < std::variant_size_v<Variant>) {
+            if (index == I) {
+                (*this)(value.template emplace<I>());
+                return;
+            }
+            alternative<Variant, I + 1>(value, index);
+        } else {
+            ok = false;
+        }
+    }
+    template <typename... Ts>
+    void operator()(std::variant<Ts...>& value) {
+        alternative(value, raw<uint8_t>());
+    }
+    void operator()(TypedValue& value) {
+        (*this)(value.type);
+        (*this)(value.value);
+    }
+
+    template <typename T>
+    void pool(std::vector<T>& items) {
+        uint32_t n = count();
+        items.resize(n);
+        for (T& item : items) {
+            for_each_field(item, *this);
+        }
+    }
+};
+
+// Checks that every reference in a decoded arena stays inside it
+struct AstArena::Validator {
+    const AstArena& arena;
+    bool ok = true;
+    // Expression nodes may only refer to earlier ones, which rules out cycles
+    size_t expression_limit = 0;
+
+    template <typename T>
+    void operator()(const T&) {}
+    void operator()(Symbol symbol) { ok = ok && symbol.id < arena.symbols.size(); }
+    void operator()(NodeRef ref) {
+        ok = ok && static_cast<size_t>(ref.kind()) < kind_count &&
+             [&]<size_t... I>(std::index_sequence<I...>) {
+                 size_t sizes[] = {std::get<I>(arena.pools).size()...};
+                 return ref.index() < sizes[static_cast<size_t>(ref.kind())];
+             }(std::make_index_sequence<kind_count>{});
+    }
+    template <typename T>
+    void operator()(Range<T> range) {
+        size_t size = arena.list_pool(static_cast<T*>(nullptr)).size();
+        ok = ok && range.first <= size && range.count <= size - range.first;
+    }
+    template <typename T>
+    void operator()(const std::optional<T>& value) {
+        if (value) (*this)(*value);
+    }
+    void operator()(ExprRef ref) { ok = ok && ref.index < expression_limit; }
+    void operator()(const Expression& expr) {
+        std::visit([this](const auto& alternative) { (*this)(alternative); }, expr);
+    }
+
+    template <typename T>
+    void pool(const std::vector<T>& items) {
+        for (const T& item : items) {
+            for_each_field(item, *this);
+        }
+    }
+};
+
+void AstArena::serialize(const AST& roots, std::string& out) const {
+    Writer writer{out};
+    writer.raw(ast_format_magic);
+    writer.raw(ast_format_version);
+
+    writer.raw(static_cast<uint32_t>(symbols.size()));
+    for (uint32_t id = 0; id < symbols.size(); ++id) {
+        writer(symbols.name(Symbol{id}));
+    }
+
+    std::apply([&](const auto&... pool) { (writer.pool(pool), ...); }, pools);
+    writer.pool(block_nodes);
+    writer.pool(symbol_lists);
+    writer.pool(expression_lists);
+    writer.pool(elif_clauses);
+    writer.pool(typed_names);
+    writer.pool(expression_nodes);
+    writer.pool(roots);
+}
+
+bool AstArena::deserialize(std::string_view data, AST& roots) {
+    Reader reader{data};
+    if (reader.raw<uint32_t>() != ast_format_magic || reader.raw<uint32_t>() != ast_format_version) {
+        return false;
+    }
+
+    uint32_t symbol_count = reader.count();
+    for (uint32_t id = 0; id < symbol_count && reader.ok; ++id) {
+        std::string name;
+        reader(name);
+        // Names are unique, so they must intern to consecutive ids
+        if (symbols.intern(name).id != id) {
+            return false;
+        }
+    }
+
+    std::apply([&](auto&... pool) { (reader.pool(pool), ...); }, pools);
+    reader.pool(block_nodes);
+    reader.pool(symbol_lists);
+    reader.pool(expression_lists);
+    reader.pool(elif_clauses);
+    reader.pool(typed_names);
+    reader.pool(expression_nodes);
+    reader.pool(roots);
+    if (!reader.ok || reader.pos != data.size()) {
+        return false;
+    }
+
+    Validator validator{*this};
+    for (size_t i = 0; i < expression_nodes.size() && validator.ok; ++i) {
+        validator.expression_limit = i;
+        for_each_field(expression_nodes[i], validator);
+        // Array and struct literal elements and call arguments are
+        // expressions too
+        ExprKind kind = expression_nodes[i].kind;
+        if (validator.ok &&
+            (kind == ExprKind::ArrayLiteral || kind == ExprKind::StructLiteral || kind == ExprKind::Call)) {
+            for (const Expression& element : list(expression_nodes[i].elements)) {
+                validator(element);
+            }
+        }
+    }
+    validator.expression_limit = expression_nodes.size();
+    std::apply([&](const auto&... pool) { (validator.pool(pool), ...); }, pools);
+    validator.pool(block_nodes);
+    validator.pool(symbol_lists);
+    validator.pool(expression_lists);
+    validator.pool(elif_clauses);
+    validator.pool(typed_names);
+    validator.pool(roots);
+    return validator.ok;
+}
@@ -0,0 +1,14 @@
+#include "../public/ast_simple.hpp"
+
+Symbol SymbolTable::intern(std::string_view text) {
+    auto it = ids.find(text);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    
+    // std::deque keeps existing strings in place, so the map keys stay valid
+    Symbol symbol{static_cast<uint32_t>(names.size())};
+    const std::string& stored = names.emplace_back(text);
+    ids.emplace(stored, symbol);
+    return symbol;
+}
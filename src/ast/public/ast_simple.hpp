@@ -2,8 +2,14 @@
 #include <variant>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <cstdint>
+#include <deque>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 
 // Type system definitions
 enum class SigType {
@@ -13,7 +19,10 @@ enum class SigType {
     Bool,
     Float,
     String,
-    Pointer     // Pointer type
+    Pointer,    // Pointer type
+    Array,      // [N]T; element type and length in an ArrayShape
+    Slice,      // []T: pointer and length viewing an array
+    Struct      // A struct value; the ArrayShape's `record` names the struct
 };
 
 // Typed value that can hold different integer types
@@ -26,6 +35,51 @@ struct TypedValue {
     > value;
 };
 
+// Interned identifier or string literal
+struct Symbol {
+    uint32_t id;
+    bool operator==(const Symbol&) const = default;
+};
+
+struct SymbolHash {
+    size_t operator()(Symbol symbol) const { return symbol.id; }
+};
+
+// Element type and length of an Array or Slice variable; a slice's length
+// is only known at run time and is 0 here. `record` names the struct of a
+// Struct variable, or of the elements when `element` is Struct.
+struct ArrayShape {
+    SigType element = SigType::I32;
+    uint32_t length = 0;
+    Symbol record{};
+};
+
+// Each distinct spelling is stored once and identified by a dense 32-bit id
+class SymbolTable {
+private:
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, Symbol> ids;
+
+public:
+    SymbolTable() = default;
+    // The index holds views into `names`, which a copy would not update
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    SymbolTable(SymbolTable&&) = default;
+    SymbolTable& operator=(SymbolTable&&) = default;
+
+    Symbol intern(std::string_view text);
+    const std::string& name(Symbol symbol) const { return names[symbol.id]; }
+    size_t size() const { return names.size(); }
+};
+
+// Contiguous run of entries in one of the AstArena list pools
+template <typename T>
+struct Range {
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
 struct ReturnStatement {
     int value;
 };
@@ -55,8 +109,47 @@ enum class SigBinaryOperator {
     RightShift
 };
 
-// Simple expression type - just basic values for now
-using Expression = std::variant<int, double, bool, std::string, TypedValue>;
+// Index of an operator or variable reference in the arena's expression pool
+struct ExprRef {
+    uint32_t index;
+};
+
+// A literal or a reference to an expression node. A Symbol is a string
+// literal; variables are ExprNodes.
+using Expression = std::variant<int, double, bool, Symbol, TypedValue, ExprRef>;
+
+enum class ExprKind : uint8_t {
+    Variable,
+    Binary,
+    Unary,
+    Index,         // name[left]
+    Slice,         // name[left:right]
+    Length,        // len(name)
+    ArrayLiteral,  // [elements...]
+    Field,         // name.field
+    ElementField,  // name[left].field
+    StructLiteral, // name { fields: elements }
+    Call           // name(elements...), a builtin with a result
+};
+
+// Operator application or variable reference. `type` is the type of the
+// result and `operand_type` the type both operands are converted to before
+// the operator applies; infer_types() fills them in after parsing. For
+// Index, Slice, ArrayLiteral and array variables `operand_type` is the
+// element type instead, and for Call the type the arguments are converted
+// to.
+struct ExprNode {
+    ExprKind kind = ExprKind::Variable;
+    SigBinaryOperator op = SigBinaryOperator::Add;
+    Symbol name{};       // Variable, the array or struct accessed, the struct a literal builds, or the builtin called
+    Symbol field{};      // Field and ElementField
+    Expression left;     // Binary and Unary; the index or slice start
+    Expression right;    // Binary; the slice end
+    Range<Expression> elements;  // ArrayLiteral; StructLiteral values; Call arguments
+    Range<Symbol> fields;        // StructLiteral field names, one per value
+    SigType type = SigType::Untyped;
+    SigType operand_type = SigType::Untyped;
+};
 
 struct BinaryExpression {
     Expression left;
@@ -78,94 +171,281 @@ struct PrintlnStatement {
 };
 
 struct AsmStatement {
-    std::string value;
+    Symbol value;
 };
 
 struct FunctionCall {
-    std::string function_name;
-    std::vector<Expression> arguments;
+    Symbol function_name;
+    Range<Expression> arguments;
 };
 
 struct VariableDeclaration {
-    std::string var_name;
+    Symbol var_name;
     std::optional<SigType> type;  // Optional type annotation
+    ArrayShape array{};           // When annotated as an array or slice
 };
 
 struct VariableAssignment {
-    std::string var_name;
+    Symbol var_name;
     Expression value;
     std::optional<SigType> type;  // Optional type annotation for declaration
+    ArrayShape array{};
+};
+
+// let name[index] = value;
+struct IndexAssignment {
+    Symbol array;
+    Expression index;
+    Expression value;
+};
+
+// let name.field = value; or let name[index].field = value;
+struct FieldAssignment {
+    Symbol target;
+    std::optional<Expression> index;
+    Symbol field;
+    Expression value;
+};
+
+// A struct field or function parameter. `record` names the struct when
+// `type` is Struct.
+struct TypedName {
+    Symbol name;
+    SigType type = SigType::I32;
+    Symbol record{};
+};
+
+// struct Name packed align(N) { field: type, ... }. Fields are laid out in
+// order of decreasing alignment to minimize padding unless the struct is
+// packed, which keeps declaration order with no padding at all. `align`
+// raises the struct's alignment to N bytes; 0 keeps the natural one.
+struct StructDefinition {
+    Symbol name;
+    Range<TypedName> fields;
+    bool packed = false;
+    uint32_t align = 0;
 };
 
 struct PrintVariable {
-    std::string variableName;
+    Symbol variableName;
 };
 
 struct ModStatement {
-    std::string filename;
+    Symbol filename;
 };
 
-// Forward declarations for control flow
-struct IfStatement;
-struct WhileStatement;
-struct ForStatement;
-struct FunctionDefinition;
-
-// Main ASTNode type
-using ASTNode = std::variant<
-    ReturnStatement,
-    PrintStatement,
-    PrintlnStatement,
-    AsmStatement,
+// Kind tag of a node; matches the order of AstArena's node pools
+enum class NodeKind : uint8_t {
+    Return,
+    Print,
+    Println,
+    Asm,
     FunctionDefinition,
     FunctionCall,
     VariableDeclaration,
     VariableAssignment,
     PrintVariable,
-    ModStatement,
+    Mod,
     BinaryExpression,
     UnaryExpression,
-    IfStatement,
-    WhileStatement,
-    ForStatement
->;
+    If,
+    While,
+    For,
+    IndexAssignment,
+    FieldAssignment,
+    StructDefinition
+};
+
+// 32-bit reference to a node: kind in the top 5 bits, pool index below
+struct NodeRef {
+    uint32_t bits;
+
+    static constexpr uint32_t index_bits = 27;
+    static constexpr uint32_t index_mask = (1u << index_bits) - 1;
+
+    static NodeRef make(NodeKind kind, uint32_t index) {
+        if (index > index_mask) {
+            too_large();
+        }
+        return NodeRef{(static_cast<uint32_t>(kind) << index_bits) | index};
+    }
+    // An index past index_bits would overwrite the kind; reports it and exits
+    [[noreturn]] static void too_large();
+    NodeKind kind() const { return static_cast<NodeKind>(bits >> index_bits); }
+    uint32_t index() const { return bits & index_mask; }
+};
+
+// A block of statements (or a whole program) in source order
+using AST = std::vector<NodeRef>;
 
 // ElifClause for if-else if chains
 struct ElifClause {
-    std::string left;
-    std::string op;
-    std::string right;
-    std::vector<ASTNode> block;
+    Expression condition;
+    Range<NodeRef> block;
 };
 
-// IfStatement structure with elif support
+// IfStatement structure with elif support. Conditions are any expression
+// that converts to bool.
 struct IfStatement {
-    std::string left;
-    std::string op;
-    std::string right;
-    std::vector<ASTNode> thenBlock;
-    std::vector<ElifClause> elifClauses;
-    std::optional<std::vector<ASTNode>> elseBlock;
+    Expression condition;
+    Range<NodeRef> thenBlock;
+    Range<ElifClause> elifClauses;
+    std::optional<Range<NodeRef>> elseBlock;
 };
 
 struct WhileStatement {
-    std::string left;
-    std::string op;
-    std::string right;
-    std::vector<ASTNode> body;
+    Expression condition;
+    Range<NodeRef> body;
 };
 
 struct FunctionDefinition {
-    std::string name;
-    std::vector<std::string> params;
-    std::vector<ASTNode> body;
+    Symbol name;
+    Range<TypedName> params;  // Untyped parameters are i32
+    Range<NodeRef> body;
 };
 
+// for (counter, start, end) with integer bounds, both inclusive
 struct ForStatement {
-    std::string initialization;
-    std::string condition;
-    std::string count;
-    std::vector<ASTNode> body;
+    Symbol initialization;
+    Expression start;
+    Expression end;
+    Range<NodeRef> body;
 };
 
-using AST = std::vector<ASTNode>;
+// Owns every node of a compilation in contiguous per-kind pools. Nodes refer
+// to each other through NodeRefs and Ranges, and names through Symbols, so
+// building the tree is a handful of vector appends and copying a subtree is
+// copying its 32-bit root.
+class AstArena {
+private:
+    using NodePools = std::tuple<
+        std::vector<ReturnStatement>,
+        std::vector<PrintStatement>,
+        std::vector<PrintlnStatement>,
+        std::vector<AsmStatement>,
+        std::vector<FunctionDefinition>,
+        std::vector<FunctionCall>,
+        std::vector<VariableDeclaration>,
+        std::vector<VariableAssignment>,
+        std::vector<PrintVariable>,
+        std::vector<ModStatement>,
+        std::vector<BinaryExpression>,
+        std::vector<UnaryExpression>,
+        std::vector<IfStatement>,
+        std::vector<WhileStatement>,
+        std::vector<ForStatement>,
+        std::vector<IndexAssignment>,
+        std::vector<FieldAssignment>,
+        std::vector<StructDefinition>
+    >;
+
+    template <typename T, typename Pools>
+    struct pool_index;
+    template <typename T, typename... Rest>
+    struct pool_index<T, std::tuple<std::vector<T>, Rest...>> : std::integral_constant<size_t, 0> {};
+    template <typename T, typename U, typename... Rest>
+    struct pool_index<T, std::tuple<std::vector<U>, Rest...>>
+        : std::integral_constant<size_t, 1 + pool_index<T, std::tuple<Rest...>>::value> {};
+
+    static constexpr size_t kind_count = std::tuple_size_v<NodePools>;
+    struct Relocation;
+    struct Writer;
+    struct Reader;
+    struct Validator;
+
+    NodePools pools;
+    std::vector<NodeRef> block_nodes;
+    std::vector<Symbol> symbol_lists;
+    std::vector<Expression> expression_lists;
+    std::vector<ElifClause> elif_clauses;
+    std::vector<TypedName> typed_names;
+    std::vector<ExprNode> expression_nodes;
+
+    std::vector<NodeRef>& list_pool(NodeRef*) { return block_nodes; }
+    std::vector<Symbol>& list_pool(Symbol*) { return symbol_lists; }
+    std::vector<Expression>& list_pool(Expression*) { return expression_lists; }
+    std::vector<ElifClause>& list_pool(ElifClause*) { return elif_clauses; }
+    std::vector<TypedName>& list_pool(TypedName*) { return typed_names; }
+    const std::vector<NodeRef>& list_pool(NodeRef*) const { return block_nodes; }
+    const std::vector<Symbol>& list_pool(Symbol*) const { return symbol_lists; }
+    const std::vector<Expression>& list_pool(Expression*) const { return expression_lists; }
+    const std::vector<ElifClause>& list_pool(ElifClause*) const { return elif_clauses; }
+    const std::vector<TypedName>& list_pool(TypedName*) const { return typed_names; }
+
+    template <size_t I, typename F>
+    decltype(auto) visit_from(NodeRef ref, F&& f) const {
+        if constexpr (I + 1 == std::tuple_size_v<NodePools>) {
+            return f(std::get<I>(pools)[ref.index()]);
+        } else {
+            if (static_cast<size_t>(ref.kind()) == I) {
+                return f(std::get<I>(pools)[ref.index()]);
+            }
+            return visit_from<I + 1>(ref, std::forward<F>(f));
+        }
+    }
+
+public:
+    SymbolTable symbols;
+
+    template <typename T>
+    static constexpr NodeKind kind_of = static_cast<NodeKind>(pool_index<T, NodePools>::value);
+
+    template <typename T>
+    NodeRef add(T node) {
+        auto& pool = std::get<pool_index<T, NodePools>::value>(pools);
+        pool.push_back(std::move(node));
+        return NodeRef::make(kind_of<T>, static_cast<uint32_t>(pool.size() - 1));
+    }
+
+    template <typename T>
+    const T& get(NodeRef ref) const {
+        return std::get<pool_index<T, NodePools>::value>(pools)[ref.index()];
+    }
+
+    template <typename T>
+    bool holds(NodeRef ref) const { return ref.kind() == kind_of<T>; }
+
+    // Calls f with the node `ref` points to, typed as its concrete struct
+    template <typename F>
+    decltype(auto) visit(NodeRef ref, F&& f) const {
+        return visit_from<0>(ref, std::forward<F>(f));
+    }
+
+    template <typename T>
+    Range<T> add_list(const std::vector<T>& items) {
+        auto& pool = list_pool(static_cast<T*>(nullptr));
+        Range<T> range{static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(items.size())};
+        pool.insert(pool.end(), items.begin(), items.end());
+        return range;
+    }
+
+    template <typename T>
+    std::span<const T> list(Range<T> range) const {
+        const auto& pool = list_pool(static_cast<T*>(nullptr));
+        return std::span<const T>(pool.data() + range.first, range.count);
+    }
+
+    // Children are added before their parents, so a node only ever refers
+    // to expression nodes with smaller indices
+    ExprRef add_expression(ExprNode node) {
+        expression_nodes.push_back(std::move(node));
+        return ExprRef{static_cast<uint32_t>(expression_nodes.size() - 1)};
+    }
+    const ExprNode& expression(ExprRef ref) const { return expression_nodes[ref.index]; }
+    ExprNode& expression(ExprRef ref) { return expression_nodes[ref.index]; }
+
+    // Moves every node and symbol of `other` into this arena and returns
+    // `roots` rewritten to refer to the moved nodes. Lets independent files
+    // be parsed into private arenas concurrently and merged afterwards.
+    AST absorb(AstArena&& other, const AST& roots);
+
+    // Compact binary encoding of the whole arena and `roots`, used by the
+    // on-disk parse cache. deserialize() expects an empty arena and returns
+    // false if `data` is truncated or refers outside itself.
+    void serialize(const AST& roots, std::string& out) const;
+    bool deserialize(std::string_view data, AST& roots);
+
+    size_t node_count() const {
+        return std::apply([](const auto&... pool) { return (pool.size() + ...); }, pools);
+    }
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include "ast_simple.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Names bound during a walk over the AST, keyed by interned Symbol. The
+// innermost binding of every name lives in a flat array indexed by symbol
+// id, so a lookup is a single index. Binding a name logs what it shadowed,
+// and pop_scope() undoes the scope's log. A function scope also hides every
+// binding made outside it, so functions never see each other's locals.
+template <typename T>
+class ScopedTable {
+private:
+    struct Entry {
+        T value{};
+        uint32_t function = 0;  // owning function scope; 0 when unbound
+    };
+    struct Shadowed {
+        uint32_t id;
+        Entry previous;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Shadowed> shadowed;
+    std::vector<size_t> scope_marks;
+    std::vector<uint32_t> function_stack{1};
+    uint32_t next_function = 2;
+
+public:
+    // Null if `name` is unbound or bound only outside the current function.
+    // The pointer is invalidated by the next bind().
+    T* find(Symbol name) {
+        if (name.id >= entries.size() || entries[name.id].function != function_stack.back()) {
+            return nullptr;
+        }
+        return &entries[name.id].value;
+    }
+
+    // Binds `name` in the innermost scope, shadowing any outer binding
+    T& bind(Symbol name, T value) {
+        if (name.id >= entries.size()) {
+            entries.resize(name.id + 1);
+        }
+        Entry& entry = entries[name.id];
+        shadowed.push_back(Shadowed{name.id, std::move(entry)});
+        entry = Entry{std::move(value), function_stack.back()};
+        return entry.value;
+    }
+
+    void push_scope() { scope_marks.push_back(shadowed.size()); }
+
+    void pop_scope() {
+        size_t mark = scope_marks.back();
+        scope_marks.pop_back();
+        while (shadowed.size() > mark) {
+            entries[shadowed.back().id] = std::move(shadowed.back().previous);
+            shadowed.pop_back();
+        }
+    }
+
+    void push_function_scope() {
+        function_stack.push_back(next_function++);
+        push_scope();
+    }
+
+    void pop_function_scope() {
+        pop_scope();
+        function_stack.pop_back();
+    }
+};
@@ -0,0 +1,107 @@
+#include "../public/cache_directory.hpp"
+#include <llvm/Support/BLAKE3.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include "../../version.hpp"
+
+static constexpr char hex_digits[] = "0123456789abcdef";
+
+CacheDirectory::CacheDirectory(std::filesystem::path dir, std::string_view magic, std::string extension)
+    : directory(std::move(dir)), magic(magic), extension(std::move(extension)) {
+    if (directory.empty()) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec || !std::filesystem::is_directory(directory, ec)) {
+        directory.clear();
+    }
+}
+
+CacheDirectory::Key CacheDirectory::make_key(std::initializer_list<std::string_view> fields) {
+    llvm::BLAKE3 hasher;
+    // NUL separators keep the fields from running into each other
+    hasher.update(llvm::StringRef(sig_version, std::strlen(sig_version) + 1));
+    for (std::string_view field : fields) {
+        hasher.update(llvm::StringRef(field.data(), field.size()));
+        hasher.update(llvm::StringRef("", 1));
+    }
+    return hasher.final<16>();
+}
+
+std::string CacheDirectory::to_hex(const Key& key) {
+    std::string text;
+    text.reserve(key.size() * 2);
+    for (uint8_t byte : key) {
+        text += hex_digits[byte >> 4];
+        text += hex_digits[byte & 0xf];
+    }
+    return text;
+}
+
+bool CacheDirectory::from_hex(std::string_view text, Key& key) {
+    if (text.size() != key.size() * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < key.size(); ++i) {
+        unsigned byte = 0;
+        if (llvm::StringRef(text.data() + i * 2, 2).getAsInteger(16, byte)) {
+            return false;
+        }
+        key[i] = static_cast<uint8_t>(byte);
+    }
+    return true;
+}
+
+std::filesystem::path CacheDirectory::entry_path(const Key& key) const {
+    return directory / (to_hex(key) + extension);
+}
+
+bool CacheDirectory::read(const Key& key, llvm::function_ref<bool(llvm::StringRef contents)> use) const {
+    if (!enabled()) {
+        return false;
+    }
+    auto entry = llvm::MemoryBuffer::getFile(entry_path(key).string(), /*IsText=*/false,
+                                             /*RequiresNullTerminator=*/false);
+    if (!entry) {
+        return false;
+    }
+    llvm::StringRef data = (*entry)->getBuffer();
+    size_t header_size = magic.size() + key.size();
+    if (data.size() < header_size || std::memcmp(data.data(), magic.data(), magic.size()) != 0 ||
+        std::memcmp(data.data() + magic.size(), key.data(), key.size()) != 0) {
+        return false;
+    }
+    return use(data.substr(header_size));
+}
+
+void CacheDirectory::write(const Key& key, llvm::StringRef contents) const {
+    if (!enabled()) {
+        return;
+    }
+
+    std::filesystem::path final_path = entry_path(key);
+    std::filesystem::path temp_path = final_path;
+    temp_path += ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+        out.write(reinterpret_cast<const char*>(key.data()), static_cast<std::streamsize>(key.size()));
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!out) {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(temp_path, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, final_path, ec);
+    if (ec) {
+        std::filesystem::remove(temp_path, ec);
+    }
+}
@@ -0,0 +1,96 @@
+#include "../public/object_cache.hpp"
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/Support/raw_ostream.h>
+
+// Named metadata carrying the key from tag() to the compiler's callbacks;
+// it is not emitted into the object
+static constexpr const char* key_metadata = "sig.object_cache";
+
+JitObjectCache::JitObjectCache(std::filesystem::path directory) : entries(std::move(directory), "SIGOBJCT", ".o") {}
+
+bool JitObjectCache::tag(llvm::Module& module, const std::string& config) {
+    if (!enabled()) {
+        return false;
+    }
+
+    if (llvm::NamedMDNode* old = module.getNamedMetadata(key_metadata)) {
+        module.eraseNamedMetadata(old);
+    }
+    llvm::SmallVector<char, 0> bitcode;
+    llvm::raw_svector_ostream stream(bitcode);
+    llvm::WriteBitcodeToFile(module, stream);
+    Key key = CacheDirectory::make_key({config, std::string_view(bitcode.data(), bitcode.size())});
+
+    llvm::LLVMContext& context = module.getContext();
+    module.getOrInsertNamedMetadata(key_metadata)->addOperand(
+        llvm::MDNode::get(context, llvm::MDString::get(context, CacheDirectory::to_hex(key))));
+
+    // The object is loaded now rather than when the compiler asks for it,
+    // or an entry removed in between would leave the unoptimized module
+    // to be compiled and stored under this key
+    std::unique_ptr<llvm::MemoryBuffer> object = load(key, module.getModuleIdentifier());
+    if (!object) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    pending[key] = std::move(object);
+    return true;
+}
+
+// The object stored under `key`; null if there is no valid entry
+std::unique_ptr<llvm::MemoryBuffer> JitObjectCache::load(const Key& key, llvm::StringRef name) const {
+    std::unique_ptr<llvm::MemoryBuffer> object;
+    entries.read(key, [&](llvm::StringRef contents) {
+        if (contents.empty()) {
+            return false;
+        }
+        object = llvm::MemoryBuffer::getMemBufferCopy(contents, name);
+        return true;
+    });
+    return object;
+}
+
+bool JitObjectCache::read_key(const llvm::Module* module, Key& key) {
+    llvm::NamedMDNode* node = module->getNamedMetadata(key_metadata);
+    if (!node || node->getNumOperands() != 1 || node->getOperand(0)->getNumOperands() != 1) {
+        return false;
+    }
+    auto* text = llvm::dyn_cast<llvm::MDString>(node->getOperand(0)->getOperand(0));
+    if (!text) {
+        return false;
+    }
+    llvm::StringRef digits = text->getString();
+    return CacheDirectory::from_hex(std::string_view(digits.data(), digits.size()), key);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> JitObjectCache::getObject(const llvm::Module* module) {
+    Key key;
+    if (!enabled() || !read_key(module, key)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> object;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        if (auto found = pending.find(key); found != pending.end()) {
+            object = std::move(found->second);
+            pending.erase(found);
+        }
+    }
+    if (!object) {
+        object = load(key, module->getModuleIdentifier());
+    }
+    ++(object ? hit_count : miss_count);
+    return object;
+}
+
+void JitObjectCache::notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) {
+    Key key;
+    if (!enabled() || !read_key(module, key)) {
+        return;
+    }
+    entries.write(key, object.getBuffer());
+}
@@ -0,0 +1,49 @@
+#include "../public/parse_cache.hpp"
+#include <cstdlib>
+
+ParseCache::ParseCache(std::filesystem::path directory) : entries(std::move(directory), "SIGCACHE", ".ast") {}
+
+std::filesystem::path ParseCache::default_directory() {
+#ifdef _WIN32
+    if (const char* local = std::getenv("LOCALAPPDATA"); local && *local) {
+        return std::filesystem::path(local) / "sig" / "cache";
+    }
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return std::filesystem::path(xdg) / "sig";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return std::filesystem::path(home) / ".cache" / "sig";
+    }
+#endif
+    return {};
+}
+
+bool ParseCache::load(const std::string& module_path, std::string_view source, AstArena& arena, AST& ast) {
+    if (!enabled()) {
+        return false;
+    }
+    
+    bool hit = entries.read(CacheDirectory::make_key({module_path, source}), [&](llvm::StringRef contents) {
+        AstArena cached;
+        AST cached_ast;
+        if (!cached.deserialize(std::string_view(contents.data(), contents.size()), cached_ast)) {
+            return false;
+        }
+        arena = std::move(cached);
+        ast = std::move(cached_ast);
+        return true;
+    });
+    ++(hit ? hit_count : miss_count);
+    return hit;
+}
+
+void ParseCache::store(const std::string& module_path, std::string_view source, const AstArena& arena, const AST& ast) {
+    if (!enabled()) {
+        return;
+    }
+    
+    std::string data;
+    arena.serialize(ast, data);
+    entries.write(CacheDirectory::make_key({module_path, source}), data);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringRef.h>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// The directory behind an on-disk cache. Each entry is named after a
+// 16-byte key hashed from everything that shaped its contents, and starts
+// with a magic tag and that key, which guard against reading an entry
+// written for different input under a colliding or truncated name.
+// Entries are written to a temporary file and renamed into place, so
+// readers on other threads or in other processes never see a partial one.
+class CacheDirectory {
+public:
+    using Key = std::array<uint8_t, 16>;
+
+private:
+    std::filesystem::path directory;
+    std::string magic;
+    std::string extension;
+
+    std::filesystem::path entry_path(const Key& key) const;
+
+public:
+    // An empty or uncreatable directory disables the cache. `magic` is the
+    // 8-byte tag of this cache's entries and `extension` their file suffix.
+    CacheDirectory(std::filesystem::path directory, std::string_view magic, std::string extension);
+
+    // Hash of the compiler version and `fields`
+    static Key make_key(std::initializer_list<std::string_view> fields);
+    static std::string to_hex(const Key& key);
+    static bool from_hex(std::string_view text, Key& key);
+
+    // Calls `use` with the contents of the entry for `key` after its
+    // header and returns its result; false if there is no valid entry
+    bool read(const Key& key, llvm::function_ref<bool(llvm::StringRef contents)> use) const;
+    void write(const Key& key, llvm::StringRef contents) const;
+
+    bool enabled() const { return !directory.empty(); }
+    const std::filesystem::path& path() const { return directory; }
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include "cache_directory.hpp"
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// On-disk cache of JIT-compiled objects. A module is tagged before it is
+// optimized with a hash of its IR and of everything else that shapes the
+// machine code (target triple, CPU, features, optimization levels, compiler
+// version); the JIT's compiler then asks for that entry instead of running
+// codegen, and stores what it compiles on a miss. Untagged modules are never
+// cached. Safe to use from concurrent compile threads.
+class JitObjectCache : public llvm::ObjectCache {
+private:
+    using Key = CacheDirectory::Key;
+
+    CacheDirectory entries;
+    std::atomic<size_t> hit_count{0};
+    std::atomic<size_t> miss_count{0};
+
+    // Objects found by tag(), held until the compiler asks for them: the
+    // module was left unoptimized, so the entry must not be re-read from
+    // disk, where it may have disappeared since
+    std::mutex pending_mutex;
+    std::map<Key, std::unique_ptr<llvm::MemoryBuffer>> pending;
+
+    static bool read_key(const llvm::Module* module, Key& key);
+    std::unique_ptr<llvm::MemoryBuffer> load(const Key& key, llvm::StringRef name) const;
+
+public:
+    // An empty or uncreatable directory disables the cache
+    explicit JitObjectCache(std::filesystem::path directory);
+
+    // Hashes `module` together with `config` and records the key in the
+    // module. True if an object for it is already cached, in which case the
+    // module need not be optimized before it is handed to the JIT; that
+    // object is kept and is what getObject() returns for the module.
+    bool tag(llvm::Module& module, const std::string& config);
+
+    // llvm::ObjectCache
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) override;
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override;
+
+    bool enabled() const { return entries.enabled(); }
+    const std::filesystem::path& path() const { return entries.path(); }
+    size_t hits() const { return hit_count; }
+    size_t misses() const { return miss_count; }
+};
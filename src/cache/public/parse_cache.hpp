@@ -0,0 +1,34 @@
+#pragma once
+#include "cache_directory.hpp"
+#include <ast/public/ast_simple.hpp>
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// On-disk cache of parsed modules. Each entry holds the serialized AST of one
+// module and is named after a hash of the module path, its exact source bytes
+// and the compiler version, so an edited file or a new compiler simply looks
+// up a different entry. Safe to use from several threads.
+class ParseCache {
+private:
+    CacheDirectory entries;
+    std::atomic<size_t> hit_count{0};
+    std::atomic<size_t> miss_count{0};
+
+public:
+    // An empty or uncreatable directory disables the cache
+    explicit ParseCache(std::filesystem::path directory);
+
+    // $XDG_CACHE_HOME/sig, else ~/.cache/sig; empty if neither can be found
+    static std::filesystem::path default_directory();
+
+    // On a hit, replaces `arena` and `ast` with the cached module
+    bool load(const std::string& module_path, std::string_view source, AstArena& arena, AST& ast);
+    void store(const std::string& module_path, std::string_view source, const AstArena& arena, const AST& ast);
+
+    bool enabled() const { return entries.enabled(); }
+    const std::filesystem::path& path() const { return entries.path(); }
+    size_t hits() const { return hit_count; }
+    size_t misses() const { return miss_count; }
+};
@@ -0,0 +1,454 @@
+#include "../public/codegen.hpp"
+#include <sema/public/type_inference.hpp>
+#include <llvm/IR/MDBuilder.h>
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+using namespace llvm;
+
+// A slice is a pointer to its first element and an i64 length
+StructType* CodeGen::slice_type() {
+    return StructType::get(*context, {PointerType::getUnqual(*context), Type::getInt64Ty(*context)});
+}
+
+Type* CodeGen::storage_type(SigType type, const ArrayShape& array) {
+    if (type == SigType::Array) {
+        return llvm::ArrayType::get(element_type(array), array.length);
+    } else if (type == SigType::Slice) {
+        return slice_type();
+    } else if (type == SigType::Struct) {
+        return record_layout(array.record).type;
+    }
+    return llvm_type(type);
+}
+
+Type* CodeGen::element_type(const ArrayShape& array) {
+    if (array.element == SigType::Struct) {
+        return record_layout(array.record).type;
+    }
+    return llvm_type(array.element);
+}
+
+// Arrays are 16-byte aligned so vectorized loops over them start on a
+// vector boundary, or more when their struct elements ask for it
+CodeGen::Variable CodeGen::declare_array(Symbol var_name, SigType type, const ArrayShape& array) {
+    AllocaInst* slot = create_entry_alloca(storage_type(type, array), name(var_name));
+    if (type == SigType::Array) {
+        Align align = std::max(slot->getAlign(), Align(16));
+        if (array.element == SigType::Struct) {
+            align = std::max(align, record_layout(array.record).align);
+        }
+        slot->setAlignment(align);
+    }
+    return variables.bind(var_name, Variable{slot, type, array});
+}
+
+Value* CodeGen::array_data(const Variable& var) {
+    if (var.type == SigType::Array) {
+        return var.slot;
+    }
+    Value* data = builder->CreateStructGEP(slice_type(), var.slot, 0);
+    return builder->CreateLoad(PointerType::getUnqual(*context), data, "data");
+}
+
+Value* CodeGen::array_length(const Variable& var) {
+    if (var.type == SigType::Array) {
+        return builder->getInt64(var.array.length);
+    }
+    Value* length = builder->CreateStructGEP(slice_type(), var.slot, 1);
+    return builder->CreateLoad(builder->getInt64Ty(), length, "len");
+}
+
+// Continues on a new block when `in_range` holds. Otherwise the index is
+// reported through the runtime, or with --no-std the program traps; that
+// path is cold, so the checked path stays straight-line code. A check that
+// folded to true emits nothing.
+void CodeGen::codegen_bounds_check(Value* in_range, Value* index, Value* length) {
+    if (auto* constant = dyn_cast<ConstantInt>(in_range); constant && constant->isOne()) {
+        return;
+    }
+    BasicBlock* ok_block = BasicBlock::Create(*context, "bounds.ok", current_function);
+    BasicBlock* fail_block = BasicBlock::Create(*context, "bounds.fail", current_function);
+    builder->CreateCondBr(in_range, ok_block, fail_block, MDBuilder(*context).createBranchWeights(1 << 20, 1));
+
+    builder->SetInsertPoint(fail_block);
+    if (Function* report = runtime_function("sig_index_out_of_bounds")) {
+        builder->CreateCall(report, {index, length});
+    } else {
+        builder->CreateIntrinsic(Intrinsic::trap, {}, {});
+    }
+    builder->CreateUnreachable();
+    builder->SetInsertPoint(ok_block);
+}
+
+// `counter`, `counter + k`, `k + counter` or `counter - k` for an integer
+// literal k; the shape of index the loop range guard can prove
+static std::optional<std::pair<Symbol, int64_t>> counter_index(const AstArena& arena, const Expression& index) {
+    auto* ref = std::get_if<ExprRef>(&index);
+    if (!ref) {
+        return std::nullopt;
+    }
+    const ExprNode& node = arena.expression(*ref);
+    auto variable = [&](const Expression& expr) -> std::optional<Symbol> {
+        auto* operand = std::get_if<ExprRef>(&expr);
+        if (operand && arena.expression(*operand).kind == ExprKind::Variable) {
+            return arena.expression(*operand).name;
+        }
+        return std::nullopt;
+    };
+
+    if (node.kind == ExprKind::Variable) {
+        return std::pair{node.name, int64_t{0}};
+    }
+    if (node.kind != ExprKind::Binary) {
+        return std::nullopt;
+    }
+    const int* right_literal = std::get_if<int>(&node.right);
+    const int* left_literal = std::get_if<int>(&node.left);
+    if (node.op == SigBinaryOperator::Add) {
+        if (auto counter = variable(node.left); counter && right_literal) {
+            return std::pair{*counter, int64_t{*right_literal}};
+        }
+        if (auto counter = variable(node.right); counter && left_literal) {
+            return std::pair{*counter, int64_t{*left_literal}};
+        }
+    } else if (node.op == SigBinaryOperator::Subtract) {
+        if (auto counter = variable(node.left); counter && right_literal) {
+            return std::pair{*counter, -int64_t{*right_literal}};
+        }
+    }
+    return std::nullopt;
+}
+
+// Address of array[index], checked against the length unless a loop guard
+// proved it
+Value* CodeGen::element_pointer(Symbol array, const Expression& index) {
+    const Variable* found = variables.find(array);
+    if (!found || !is_array_type(found->type)) {
+        std::cerr << "Error: " << name(array) << " is not an array or slice" << std::endl;
+        return nullptr;
+    }
+    Variable var = *found;
+    Value* position = codegen_typed(index, SigType::I64);
+    if (!position) {
+        return nullptr;
+    }
+
+    bool proven = false;
+    if (auto access = counter_index(*ast_arena, index)) {
+        proven = std::any_of(proven_accesses.begin(), proven_accesses.end(), [&](const RangeProof& proof) {
+            return proof.array == array && proof.counter == access->first && proof.offset == access->second;
+        });
+    }
+    if (!proven) {
+        // Unsigned, so a negative index fails too
+        Value* length = array_length(var);
+        codegen_bounds_check(builder->CreateICmpULT(position, length, "in.bounds"), position, length);
+    }
+    return builder->CreateInBoundsGEP(element_type(var.array), array_data(var), position, "element");
+}
+
+// Index, Slice and Length nodes. A slice is returned as its {ptr, i64}
+// value.
+Value* CodeGen::codegen_array_access(const ExprNode& node) {
+    if (node.kind == ExprKind::Index) {
+        Value* element = element_pointer(node.name, node.left);
+        if (!element) {
+            return nullptr;
+        }
+        return builder->CreateLoad(llvm_type(node.type), element, name(node.name));
+    }
+
+    const Variable* found = variables.find(node.name);
+    if (!found || !is_array_type(found->type)) {
+        std::cerr << "Error: " << name(node.name) << " is not an array or slice" << std::endl;
+        return nullptr;
+    }
+    Variable var = *found;
+    if (node.kind == ExprKind::Length) {
+        return array_length(var);
+    }
+
+    // start <= end <= length
+    Value* start = codegen_typed(node.left, SigType::I64);
+    Value* end = codegen_typed(node.right, SigType::I64);
+    if (!start || !end) {
+        return nullptr;
+    }
+    Value* length = array_length(var);
+    Value* end_in_range = builder->CreateICmpULE(end, length, "end.in.bounds");
+    Value* in_range = builder->CreateAnd(builder->CreateICmpULE(start, end, "start.in.bounds"), end_in_range);
+    codegen_bounds_check(in_range, builder->CreateSelect(end_in_range, start, end), length);
+
+    Value* data = builder->CreateInBoundsGEP(element_type(var.array), array_data(var), start, "slice.data");
+    Value* slice = builder->CreateInsertValue(UndefValue::get(slice_type()), data, 0);
+    return builder->CreateInsertValue(slice, builder->CreateSub(end, start, "slice.len"), 1);
+}
+
+// let a: [N]T; starts zeroed, and let s: []T; empty
+Value* CodeGen::codegen_array_declaration(const VariableDeclaration& s) {
+    Variable var = declare_array(s.var_name, *s.type, s.array);
+    if (var.type == SigType::Slice) {
+        return builder->CreateStore(Constant::getNullValue(slice_type()), var.slot);
+    }
+    auto* slot = cast<AllocaInst>(var.slot);
+    uint64_t size = module->getDataLayout().getTypeAllocSize(slot->getAllocatedType());
+    return builder->CreateMemSet(slot, builder->getInt8(0), size, slot->getAlign());
+}
+
+// An array is filled from a literal or copied from another array; a slice
+// views an array, a slice of one, or another slice's elements. Sema has
+// matched the shapes.
+Value* CodeGen::codegen_array_assignment(const VariableAssignment& s) {
+    const ExprNode& value = ast_arena->expression(std::get<ExprRef>(s.value));
+    const Variable* source = value.kind == ExprKind::Variable ? variables.find(value.name) : nullptr;
+    if (value.kind == ExprKind::Variable && !source) {
+        std::cerr << "Error: Undefined variable " << name(value.name) << std::endl;
+        return nullptr;
+    }
+    Variable source_var = source ? *source : Variable{};
+
+    Variable var;
+    if (const Variable* found = variables.find(s.var_name)) {
+        var = *found;
+    } else if (s.type) {
+        var = declare_array(s.var_name, *s.type, s.array);
+    } else if (value.kind == ExprKind::Variable) {
+        var = declare_array(s.var_name, source_var.type, source_var.array);
+    } else if (value.kind == ExprKind::Slice) {
+        const Variable* viewed = variables.find(value.name);
+        var = declare_array(s.var_name, SigType::Slice,
+                            ArrayShape{value.operand_type, 0, viewed ? viewed->array.record : Symbol{}});
+    } else {
+        var = declare_array(s.var_name, SigType::Array, ArrayShape{value.operand_type, value.elements.count});
+    }
+
+    if (var.type == SigType::Array && value.kind == ExprKind::ArrayLiteral) {
+        // Every element is evaluated before any is stored, so the literal
+        // may read the array it replaces
+        std::vector<Value*> elements;
+        for (const Expression& element : ast_arena->list(value.elements)) {
+            Value* converted = codegen_typed(element, var.array.element);
+            if (!converted) {
+                return nullptr;
+            }
+            elements.push_back(converted);
+        }
+        Type* element_type = llvm_type(var.array.element);
+        for (size_t i = 0; i < elements.size(); ++i) {
+            builder->CreateStore(elements[i], builder->CreateConstInBoundsGEP1_64(element_type, var.slot, i));
+        }
+        return var.slot;
+    }
+    if (var.type == SigType::Array) {
+        if (source_var.slot == var.slot) {
+            return var.slot;
+        }
+        // Arrays are never parameters, so both are allocas
+        auto* slot = cast<AllocaInst>(var.slot);
+        auto* source_slot = cast<AllocaInst>(source_var.slot);
+        uint64_t size = module->getDataLayout().getTypeAllocSize(slot->getAllocatedType());
+        return builder->CreateMemCpy(slot, slot->getAlign(), source_slot, source_slot->getAlign(), size);
+    }
+
+    Value* slice;
+    if (value.kind == ExprKind::Slice) {
+        slice = codegen_array_access(value);
+        if (!slice) {
+            return nullptr;
+        }
+    } else if (source_var.type == SigType::Slice) {
+        slice = builder->CreateLoad(slice_type(), source_var.slot, name(value.name));
+    } else {
+        slice = builder->CreateInsertValue(UndefValue::get(slice_type()), source_var.slot, 0);
+        slice = builder->CreateInsertValue(slice, builder->getInt64(source_var.array.length), 1);
+    }
+    return builder->CreateStore(slice, var.slot);
+}
+
+Value* CodeGen::codegen_index_assignment(const IndexAssignment& s) {
+    const Variable* found = variables.find(s.array);
+    if (!found || !is_array_type(found->type)) {
+        std::cerr << "Error: " << name(s.array) << " is not an array or slice" << std::endl;
+        return nullptr;
+    }
+    SigType element = found->array.element;
+    if (element == SigType::Struct) {
+        Symbol record = found->array.record;
+        Value* pointer = element_pointer(s.array, s.index);
+        return pointer ? store_struct(pointer, record, s.value) : nullptr;
+    }
+    Value* value = codegen_typed(s.value, element);
+    Value* pointer = value ? element_pointer(s.array, s.index) : nullptr;
+    if (!pointer) {
+        return nullptr;
+    }
+    return builder->CreateStore(value, pointer);
+}
+
+namespace {
+
+// Collects the array[counter + k] accesses in a loop body, and what would
+// invalidate proving them before the loop: the counter or an array being
+// assigned or redeclared, or a function being defined (whose body would be
+// compiled twice along with the loop's). Nested loops are noted, since
+// versioning the loop would copy them as well.
+struct LoopAccessScan {
+    const AstArena& arena;
+    Symbol counter;
+    bool counter_rebound = false;
+    bool defines_function = false;
+    bool has_loops = false;
+    std::vector<Symbol> rebound;
+    std::vector<std::pair<Symbol, int64_t>> accesses;
+
+    LoopAccessScan(const AstArena& arena, Symbol counter) : arena(arena), counter(counter) {}
+
+    void bind(Symbol name) {
+        rebound.push_back(name);
+        counter_rebound = counter_rebound || name == counter;
+    }
+
+    void access(Symbol array, const Expression& index) {
+        if (auto found = counter_index(arena, index); found && found->first == counter) {
+            accesses.emplace_back(array, found->second);
+        }
+    }
+
+    void expression(const Expression& expr) {
+        auto* ref = std::get_if<ExprRef>(&expr);
+        if (!ref) {
+            return;
+        }
+        const ExprNode& node = arena.expression(*ref);
+        if (node.kind == ExprKind::Index || node.kind == ExprKind::ElementField) {
+            access(node.name, node.left);
+        }
+        expression(node.left);
+        expression(node.right);
+        for (const Expression& element : arena.list(node.elements)) {
+            expression(element);
+        }
+    }
+
+    void block(Range<NodeRef> body) {
+        for (NodeRef stmt : arena.list(body)) {
+            statement(stmt);
+        }
+    }
+
+    void statement(NodeRef stmt) {
+        arena.visit(stmt, [this](const auto& s) {
+            using T = std::decay_t<decltype(s)>;
+
+            if constexpr (std::is_same_v<T, PrintStatement> || std::is_same_v<T, PrintlnStatement>) {
+                expression(s.value);
+            } else if constexpr (std::is_same_v<T, VariableDeclaration>) {
+                bind(s.var_name);
+            } else if constexpr (std::is_same_v<T, VariableAssignment>) {
+                expression(s.value);
+                bind(s.var_name);
+            } else if constexpr (std::is_same_v<T, IndexAssignment>) {
+                access(s.array, s.index);
+                expression(s.index);
+                expression(s.value);
+            } else if constexpr (std::is_same_v<T, FieldAssignment>) {
+                if (s.index) {
+                    access(s.target, *s.index);
+                    expression(*s.index);
+                }
+                expression(s.value);
+            } else if constexpr (std::is_same_v<T, FunctionCall>) {
+                for (const Expression& argument : arena.list(s.arguments)) {
+                    expression(argument);
+                }
+            } else if constexpr (std::is_same_v<T, BinaryExpression>) {
+                expression(s.left);
+                expression(s.right);
+            } else if constexpr (std::is_same_v<T, UnaryExpression>) {
+                expression(s.operand);
+            } else if constexpr (std::is_same_v<T, FunctionDefinition>) {
+                defines_function = true;
+            } else if constexpr (std::is_same_v<T, IfStatement>) {
+                expression(s.condition);
+                block(s.thenBlock);
+                for (const ElifClause& clause : arena.list(s.elifClauses)) {
+                    expression(clause.condition);
+                    block(clause.block);
+                }
+                if (s.elseBlock) {
+                    block(*s.elseBlock);
+                }
+            } else if constexpr (std::is_same_v<T, WhileStatement>) {
+                has_loops = true;
+                expression(s.condition);
+                block(s.body);
+            } else if constexpr (std::is_same_v<T, ForStatement>) {
+                has_loops = true;
+                expression(s.start);
+                expression(s.end);
+                bind(s.initialization);
+                block(s.body);
+            }
+        });
+    }
+};
+
+}  // namespace
+
+// Whether the body of a for loop may assign its counter
+bool CodeGen::rebinds_counter(const ForStatement& s) const {
+    LoopAccessScan scan{*ast_arena, s.initialization};
+    scan.block(s.body);
+    return scan.counter_rebound;
+}
+
+// A condition, evaluated before the loop, under which every access
+// array[counter + k] in the body is in bounds for all counter values in
+// [start, end]: start + k >= 0 and end + k < length, written so neither
+// side can overflow. Null when the body has no such access or the proof
+// would not hold throughout it; `proofs` receives the accesses covered.
+// With constant bounds over arrays the condition folds to a constant. A
+// loop holding other loops only takes a constant condition: a runtime one
+// would have it compiled twice, and every level of nesting would double
+// the code again.
+Value* CodeGen::codegen_range_guard(const ForStatement& s, Value* start, Value* end, std::vector<RangeProof>& proofs) {
+    LoopAccessScan scan{*ast_arena, s.initialization};
+    scan.block(s.body);
+    if (scan.counter_rebound || scan.defines_function) {
+        return nullptr;
+    }
+
+    std::sort(scan.accesses.begin(), scan.accesses.end(), [](const auto& a, const auto& b) {
+        return std::pair{a.first.id, a.second} < std::pair{b.first.id, b.second};
+    });
+    scan.accesses.erase(std::unique(scan.accesses.begin(), scan.accesses.end()), scan.accesses.end());
+
+    Value* start64 = builder->CreateSExt(start, builder->getInt64Ty());
+    Value* end64 = builder->CreateSExt(end, builder->getInt64Ty());
+    Value* guard = nullptr;
+    for (const auto& [array, offset] : scan.accesses) {
+        const Variable* var = variables.find(array);
+        if (!var || !is_array_type(var->type) ||
+            std::find(scan.rebound.begin(), scan.rebound.end(), array) != scan.rebound.end()) {
+            continue;
+        }
+        Value* low = builder->CreateICmpSGE(start64, builder->getInt64(static_cast<uint64_t>(-offset)));
+        Value* limit = builder->CreateSub(array_length(*var), builder->getInt64(static_cast<uint64_t>(offset)));
+        Value* high = builder->CreateICmpSLT(end64, limit);
+        Value* covered = builder->CreateAnd(high, low);
+        guard = guard ? builder->CreateAnd(guard, covered) : covered;
+        proofs.push_back(RangeProof{array, s.initialization, offset});
+    }
+    if (!guard) {
+        return nullptr;
+    }
+    // An empty range needs no proof
+    guard = builder->CreateOr(builder->CreateICmpSGT(start, end), guard, "range.guard");
+    if (scan.has_loops && !isa<Constant>(guard)) {
+        proofs.clear();
+        return nullptr;
+    }
+    return guard;
+}
@@ -0,0 +1,176 @@
+#include "../public/codegen.hpp"
+#include <sema/public/type_inference.hpp>
+#include <llvm/IR/Intrinsics.h>
+#include <iostream>
+#include <string_view>
+
+using namespace llvm;
+
+namespace {
+
+// The intrinsics behind each builtin in find_builtin(). With all-integer
+// arguments the integer form is used when there is one, its unsigned
+// variant for unsigned arguments; otherwise integers are converted to
+// double for the float form.
+struct IntrinsicBuiltin {
+    std::string_view name;
+    Intrinsic::ID float_id;     // not_intrinsic: integers only
+    Intrinsic::ID int_id;       // not_intrinsic: floats only
+    Intrinsic::ID unsigned_id;  // not_intrinsic: the same as int_id
+};
+
+constexpr IntrinsicBuiltin intrinsic_builtins[] = {
+    {"abs", Intrinsic::fabs, Intrinsic::abs, Intrinsic::not_intrinsic},
+    {"sqrt", Intrinsic::sqrt, Intrinsic::not_intrinsic, Intrinsic::not_intrinsic},
+    {"max", Intrinsic::maxnum, Intrinsic::smax, Intrinsic::umax},
+    {"min", Intrinsic::minnum, Intrinsic::smin, Intrinsic::umin},
+    {"floor", Intrinsic::floor, Intrinsic::not_intrinsic, Intrinsic::not_intrinsic},
+    {"ceil", Intrinsic::ceil, Intrinsic::not_intrinsic, Intrinsic::not_intrinsic},
+    {"fma", Intrinsic::fma, Intrinsic::not_intrinsic, Intrinsic::not_intrinsic},
+    {"pow", Intrinsic::pow, Intrinsic::not_intrinsic, Intrinsic::not_intrinsic},
+    {"popcount", Intrinsic::not_intrinsic, Intrinsic::ctpop, Intrinsic::not_intrinsic},
+    {"ctz", Intrinsic::not_intrinsic, Intrinsic::cttz, Intrinsic::not_intrinsic},
+    {"clz", Intrinsic::not_intrinsic, Intrinsic::ctlz, Intrinsic::not_intrinsic},
+    {"bswap", Intrinsic::not_intrinsic, Intrinsic::bswap, Intrinsic::not_intrinsic},
+    {"rotate", Intrinsic::not_intrinsic, Intrinsic::fshl, Intrinsic::not_intrinsic},
+};
+
+}  // namespace
+
+// Lowers math and bit builtins to intrinsics rather than calls into the
+// runtime, so they fold, vectorize and need no C library (--no-std
+// included; only pow may still become a libm call in the backend).
+// Returns false if `function_name` is not such a builtin; otherwise
+// `result` is the value, or null after an error has been printed and
+// codegen_failed set.
+// `arg_types` gives each argument's signedness.
+bool CodeGen::codegen_builtin_call(const std::string& function_name, std::vector<Value*>& args,
+                                   const std::vector<SigType>& arg_types, Value*& result) {
+    const IntrinsicBuiltin* builtin = nullptr;
+    for (const IntrinsicBuiltin& candidate : intrinsic_builtins) {
+        if (candidate.name == function_name) {
+            builtin = &candidate;
+            break;
+        }
+    }
+    const BuiltinSignature* signature = find_builtin(function_name);
+    if (!builtin || !signature) {
+        return false;
+    }
+
+    result = nullptr;
+    if (args.size() != signature->arity) {
+        std::cerr << "Error: " << function_name << " expects " << signature->arity << " argument(s), got "
+                  << args.size() << std::endl;
+        codegen_failed = true;
+        return true;
+    }
+
+    bool all_integer = true;
+    for (Value* arg : args) {
+        if (!arg->getType()->isIntegerTy() || arg->getType()->isIntegerTy(1)) {
+            all_integer = false;
+        }
+    }
+
+    if (all_integer && builtin->int_id != Intrinsic::not_intrinsic) {
+        Type* type = args[0]->getType();
+        bool is_unsigned = !is_signed_type(arg_types[0]);
+        Intrinsic::ID id = is_unsigned && builtin->unsigned_id != Intrinsic::not_intrinsic ? builtin->unsigned_id
+                                                                                           : builtin->int_id;
+        switch (id) {
+            case Intrinsic::abs:
+                // INT_MIN stays INT_MIN rather than being poison; an
+                // unsigned value is its own absolute value
+                result = is_unsigned ? args[0]
+                                     : builder->CreateBinaryIntrinsic(Intrinsic::abs, args[0], builder->getFalse());
+                break;
+            case Intrinsic::cttz:
+            case Intrinsic::ctlz:
+                // Zero is defined: the bit width
+                result = builder->CreateBinaryIntrinsic(id, args[0], builder->getFalse());
+                break;
+            case Intrinsic::fshl:
+                // A funnel shift of a value with itself is a rotate left
+                result = builder->CreateIntrinsic(Intrinsic::fshl, {type},
+                                                  {args[0], args[0], builder->CreateZExtOrTrunc(args[1], type)});
+                break;
+            default:
+                result = builder->CreateIntrinsic(id, {type}, args);
+                break;
+        }
+        return true;
+    }
+
+    if (builtin->float_id == Intrinsic::not_intrinsic) {
+        std::cerr << "Error: " << function_name << " expects integer arguments" << std::endl;
+        codegen_failed = true;
+        return true;
+    }
+
+    Type* double_type = Type::getDoubleTy(*context);
+    for (size_t i = 0; i < args.size(); ++i) {
+        Value*& arg = args[i];
+        if (arg->getType()->isIntegerTy(1)) {
+            std::cerr << "Error: " << function_name << " expects numeric arguments" << std::endl;
+            codegen_failed = true;
+            return true;
+        }
+        if (arg->getType()->isIntegerTy()) {
+            arg = is_signed_type(arg_types[i]) ? builder->CreateSIToFP(arg, double_type)
+                                               : builder->CreateUIToFP(arg, double_type);
+        } else if (!arg->getType()->isDoubleTy()) {
+            std::cerr << "Error: " << function_name << " expects numeric arguments" << std::endl;
+            codegen_failed = true;
+            return true;
+        }
+    }
+
+    result = builder->CreateIntrinsic(builtin->float_id, {double_type}, args);
+    if (builtin->float_id == Intrinsic::sqrt) {
+        // Negative inputs give 0 rather than NaN, as they always have
+        Value* negative = builder->CreateFCmpOLT(args[0], ConstantFP::get(double_type, 0.0));
+        result = builder->CreateSelect(negative, ConstantFP::get(double_type, 0.0), result);
+    }
+    return true;
+}
+
+// A builtin called inside an expression. Its arguments are converted to
+// the type inference chose for them; len takes a string.
+Value* CodeGen::codegen_call(const ExprNode& node) {
+    const std::string& function_name = name(node.name);
+    auto arguments = ast_arena->list(node.elements);
+    if (function_name == "len" && arguments.size() == 1) {
+        Value* text = codegen_expression(arguments[0]);
+        return text ? string_length(text) : nullptr;
+    }
+
+    std::vector<Value*> args;
+    std::vector<SigType> arg_types;
+    for (const Expression& argument : arguments) {
+        Value* value = codegen_typed(argument, node.operand_type);
+        if (!value) {
+            return nullptr;
+        }
+        args.push_back(value);
+        arg_types.push_back(node.operand_type);
+    }
+
+    Value* result = nullptr;
+    if (!codegen_builtin_call(function_name, args, arg_types, result)) {
+        std::cerr << "Error: Undefined function " << function_name << std::endl;
+        codegen_failed = true;
+    }
+    return result;
+}
+
+// Length of a string, as an i64 like the length of an array
+Value* CodeGen::string_length(Value* text) {
+    Function* len = module->getFunction("sig_len");
+    if (no_std || !len) {
+        std::cerr << "Error: len() of a string is not available with --no-std" << std::endl;
+        codegen_failed = true;
+        return nullptr;
+    }
+    return builder->CreateZExt(builder->CreateCall(len, {text}, "len"), builder->getInt64Ty());
+}
@@ -0,0 +1,307 @@
+#include "../public/codegen.hpp"
+#include <sema/public/type_inference.hpp>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/MDBuilder.h>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+using namespace llvm;
+
+// Allocas all go at the top of the entry block, wherever the declaration
+// appears, so mem2reg and SROA can turn them into SSA values
+AllocaInst* CodeGen::create_entry_alloca(Type* type, const std::string& var_name) {
+    BasicBlock& entry = current_function->getEntryBlock();
+    IRBuilder<> entry_builder(&entry, entry.getFirstNonPHIOrDbgOrAlloca());
+    return entry_builder.CreateAlloca(type, nullptr, var_name);
+}
+
+// Each block is a scope: variables first assigned inside it end with it
+void CodeGen::codegen_block(Range<NodeRef> block) {
+    variables.push_scope();
+    for (NodeRef stmt : ast_arena->list(block)) {
+        codegen_stmt(stmt);
+    }
+    variables.pop_scope();
+}
+
+// An if, elif or while condition, converted to bool as an assignment to a
+// bool variable would: numbers are true when non-zero. Type inference has
+// already rejected strings, arrays and structs.
+Value* CodeGen::codegen_condition(const Expression& condition) {
+    SigType type = expression_type(*ast_arena, condition);
+    if (!is_integer_type(type) && type != SigType::Bool && type != SigType::Float) {
+        std::cerr << "Error: A " << type_name(type) << " cannot be a condition" << std::endl;
+        return nullptr;
+    }
+    return codegen_typed(condition, SigType::Bool);
+}
+
+// Each clause tests its condition where the previous one failed; blocks are
+// placed in source order. A branch that ends in a return does not fall
+// through to if.end.
+Value* CodeGen::codegen_if(const IfStatement& s) {
+    BasicBlock* end_block = BasicBlock::Create(*context, "if.end");
+
+    auto emit_clause = [&](const Expression& condition, Range<NodeRef> block, BasicBlock* else_block) {
+        Value* cond = codegen_condition(condition);
+        if (!cond) {
+            return false;
+        }
+        BasicBlock* then_block = BasicBlock::Create(*context, "if.then", current_function);
+        builder->CreateCondBr(cond, then_block, else_block);
+
+        builder->SetInsertPoint(then_block);
+        codegen_block(block);
+        if (!builder->GetInsertBlock()->getTerminator()) {
+            builder->CreateBr(end_block);
+        }
+        return true;
+    };
+
+    auto elif_clauses = ast_arena->list(s.elifClauses);
+    std::vector<BasicBlock*> else_blocks;
+    for (size_t i = 0; i < elif_clauses.size(); ++i) {
+        else_blocks.push_back(BasicBlock::Create(*context, "if.elif"));
+    }
+    else_blocks.push_back(s.elseBlock ? BasicBlock::Create(*context, "if.else") : end_block);
+
+    // A condition that failed ends its block. The blocks not yet placed,
+    // which earlier clauses may branch to, are placed and terminated so the
+    // function stays well formed until compile() stops.
+    auto abandon = [&](size_t first_unplaced) -> Value* {
+        builder->CreateUnreachable();
+        for (size_t i = first_unplaced; i < else_blocks.size(); ++i) {
+            if (else_blocks[i] != end_block) {
+                else_blocks[i]->insertInto(current_function);
+                builder->SetInsertPoint(else_blocks[i]);
+                builder->CreateUnreachable();
+            }
+        }
+        end_block->insertInto(current_function);
+        builder->SetInsertPoint(end_block);
+        codegen_failed = true;
+        return nullptr;
+    };
+
+    if (!emit_clause(s.condition, s.thenBlock, else_blocks[0])) {
+        return abandon(0);
+    }
+    for (size_t i = 0; i < elif_clauses.size(); ++i) {
+        else_blocks[i]->insertInto(current_function);
+        builder->SetInsertPoint(else_blocks[i]);
+        const ElifClause& clause = elif_clauses[i];
+        if (!emit_clause(clause.condition, clause.block, else_blocks[i + 1])) {
+            return abandon(i + 1);
+        }
+    }
+    if (s.elseBlock) {
+        else_blocks.back()->insertInto(current_function);
+        builder->SetInsertPoint(else_blocks.back());
+        codegen_block(*s.elseBlock);
+        if (!builder->GetInsertBlock()->getTerminator()) {
+            builder->CreateBr(end_block);
+        }
+    }
+
+    // With every branch returning, if.end is unreachable but still the
+    // place for whatever follows
+    end_block->insertInto(current_function);
+    builder->SetInsertPoint(end_block);
+    return nullptr;
+}
+
+Value* CodeGen::codegen_while(const WhileStatement& s) {
+    BasicBlock* cond_block = BasicBlock::Create(*context, "while.cond", current_function);
+    builder->CreateBr(cond_block);
+
+    builder->SetInsertPoint(cond_block);
+    Value* cond = codegen_condition(s.condition);
+    if (!cond) {
+        // Nothing runs past a condition that failed; compile() stops
+        builder->CreateUnreachable();
+        codegen_failed = true;
+        return nullptr;
+    }
+    BasicBlock* body_block = BasicBlock::Create(*context, "while.body", current_function);
+    BasicBlock* end_block = BasicBlock::Create(*context, "while.end");
+    builder->CreateCondBr(cond, body_block, end_block);
+
+    builder->SetInsertPoint(body_block);
+    codegen_block(s.body);
+    if (!builder->GetInsertBlock()->getTerminator()) {
+        BranchInst* latch = builder->CreateBr(cond_block);
+        // `while (1)` may legitimately never finish, so no mustprogress
+        add_loop_hints(latch, cond_block, false);
+    }
+
+    end_block->insertInto(current_function);
+    builder->SetInsertPoint(end_block);
+    return nullptr;
+}
+
+// for (i, start, end) counts i from start to end inclusive. The bound is
+// evaluated once, and i is only incremented while it is below the bound,
+// so it never wraps, even when end is the type's maximum. Unless the body
+// assigns i, the increment is marked nsw and the loop must progress,
+// which lets scalar evolution compute the trip count for the vectorizer
+// and unroller.
+//
+// When the body indexes arrays with i + k, the loop is versioned: a guard
+// before it checks once that every such index stays in bounds, and if so a
+// copy of the loop without those checks runs; otherwise the checked loop
+// does. Constant bounds over arrays fold the guard and keep one copy; only
+// innermost loops are versioned on a runtime guard.
+Value* CodeGen::codegen_for(const ForStatement& s) {
+    SigType start_sig = expression_type(*ast_arena, s.start);
+    SigType end_sig = expression_type(*ast_arena, s.end);
+    if (!is_integer_type(start_sig) || !is_integer_type(end_sig)) {
+        std::cerr << "Error: for loop bounds must be integers" << std::endl;
+        codegen_failed = true;
+        return nullptr;
+    }
+    Value* start = codegen_expression(s.start);
+    Value* end = start ? codegen_expression(s.end) : nullptr;
+    if (!start || !end) {
+        codegen_failed = true;
+        return nullptr;
+    }
+    // The counter is signed and at least 32 bits, as in type inference
+    SigType counter_sig = type_bits(start_sig) == 64 || type_bits(end_sig) == 64 ? SigType::I64 : SigType::I32;
+    start = convert_value(start, start_sig, counter_sig);
+    end = convert_value(end, end_sig, counter_sig);
+
+    bool counter_rebound = rebinds_counter(s);
+    std::vector<RangeProof> proofs;
+    Value* guard = codegen_range_guard(s, start, end, proofs);
+    auto emit_unchecked = [&] {
+        size_t outer_proofs = proven_accesses.size();
+        proven_accesses.insert(proven_accesses.end(), proofs.begin(), proofs.end());
+        codegen_for_loop(s, start, end, counter_sig, counter_rebound);
+        proven_accesses.resize(outer_proofs);
+    };
+
+    if (!guard || isa<ConstantInt>(guard)) {
+        if (guard && cast<ConstantInt>(guard)->isOne()) {
+            emit_unchecked();
+        } else {
+            codegen_for_loop(s, start, end, counter_sig, counter_rebound);
+        }
+        return nullptr;
+    }
+
+    BasicBlock* unchecked_block = BasicBlock::Create(*context, "for.unchecked", current_function);
+    BasicBlock* checked_block = BasicBlock::Create(*context, "for.checked");
+    BasicBlock* done_block = BasicBlock::Create(*context, "for.done");
+    builder->CreateCondBr(guard, unchecked_block, checked_block, MDBuilder(*context).createBranchWeights(1 << 20, 1));
+
+    builder->SetInsertPoint(unchecked_block);
+    emit_unchecked();
+    builder->CreateBr(done_block);
+
+    checked_block->insertInto(current_function);
+    builder->SetInsertPoint(checked_block);
+    codegen_for_loop(s, start, end, counter_sig, counter_rebound);
+    builder->CreateBr(done_block);
+
+    done_block->insertInto(current_function);
+    builder->SetInsertPoint(done_block);
+    return nullptr;
+}
+
+// Emitted in rotated form: the bound is tested once on entry and then at
+// the bottom of each iteration, before the increment, which leaves the loop
+// a single exit.
+void CodeGen::codegen_for_loop(const ForStatement& s, Value* start, Value* end, SigType counter_sig,
+                               bool counter_rebound) {
+    Type* counter_type = llvm_type(counter_sig);
+
+    // The counter is visible in the body only
+    const std::string& counter_name = name(s.initialization);
+    AllocaInst* counter = create_entry_alloca(counter_type, counter_name);
+    variables.push_scope();
+    variables.bind(s.initialization, Variable{counter, counter_sig});
+    builder->CreateStore(start, counter);
+
+    BasicBlock* body_block = BasicBlock::Create(*context, "for.body");
+    BasicBlock* inc_block = BasicBlock::Create(*context, "for.inc");
+    BasicBlock* step_block = BasicBlock::Create(*context, "for.step");
+    BasicBlock* end_block = BasicBlock::Create(*context, "for.end");
+    builder->CreateCondBr(builder->CreateICmpSLE(start, end, "for.enter"), body_block, end_block);
+
+    body_block->insertInto(current_function);
+    builder->SetInsertPoint(body_block);
+    codegen_block(s.body);
+    if (!builder->GetInsertBlock()->getTerminator()) {
+        builder->CreateBr(inc_block);
+    }
+
+    // Reloaded, since the body may assign the counter. i < end means i + 1
+    // <= end, so the next iteration needs no test of its own.
+    inc_block->insertInto(current_function);
+    builder->SetInsertPoint(inc_block);
+    Value* last = builder->CreateLoad(counter_type, counter, counter_name);
+    Value* more = builder->CreateICmpSLT(last, end, "for.test");
+    BranchInst* test = builder->CreateCondBr(more, step_block, end_block);
+
+    // Constant bounds give the estimated trip count the loop passes read
+    // from branch weights
+    auto* start_constant = dyn_cast<ConstantInt>(start);
+    auto* end_constant = dyn_cast<ConstantInt>(end);
+    if (start_constant && end_constant && end_constant->getSExtValue() >= start_constant->getSExtValue()) {
+        uint64_t back_edges = static_cast<uint64_t>(end_constant->getSExtValue() - start_constant->getSExtValue());
+        uint32_t weight = static_cast<uint32_t>(std::min<uint64_t>(back_edges, std::numeric_limits<uint32_t>::max()));
+        test->setMetadata(LLVMContext::MD_prof, MDBuilder(*context).createBranchWeights(weight, 1));
+    }
+
+    // A body that assigns the counter may hold it back forever, so such a
+    // loop is not required to make progress
+    step_block->insertInto(current_function);
+    builder->SetInsertPoint(step_block);
+    Value* one = ConstantInt::get(counter_type, 1);
+    Value* next = counter_rebound ? builder->CreateAdd(last, one, "for.next")
+                                  : builder->CreateNSWAdd(last, one, "for.next");
+    builder->CreateStore(next, counter);
+    BranchInst* latch = builder->CreateBr(body_block);
+    add_loop_hints(latch, body_block, !counter_rebound);
+    variables.pop_scope();
+
+    end_block->insertInto(current_function);
+    builder->SetInsertPoint(end_block);
+}
+
+// Attaches llvm.loop metadata to the back edge `latch`. Loops made only of
+// arithmetic and intrinsics are marked for vectorization, which also
+// applies at -O1 and -Os where the vectorizer otherwise stays off; loops
+// that call out (print, user functions) gain nothing from unrolling but
+// size, so it is disabled for them.
+void CodeGen::add_loop_hints(BranchInst* latch, BasicBlock* header, bool finite) {
+    bool has_calls = false;
+    for (auto block = header->getIterator(); !has_calls; ++block) {
+        for (Instruction& inst : *block) {
+            if (isa<CallBase>(inst) && !isa<IntrinsicInst>(inst)) {
+                has_calls = true;
+                break;
+            }
+        }
+        if (&*block == latch->getParent()) {
+            break;
+        }
+    }
+
+    LLVMContext& ctx = *context;
+    SmallVector<Metadata*, 3> operands = {nullptr};  // the loop ID refers to itself
+    if (finite) {
+        operands.push_back(MDNode::get(ctx, MDString::get(ctx, "llvm.loop.mustprogress")));
+    }
+    if (has_calls) {
+        operands.push_back(MDNode::get(ctx, MDString::get(ctx, "llvm.loop.unroll.disable")));
+    } else {
+        operands.push_back(MDNode::get(ctx, {MDString::get(ctx, "llvm.loop.vectorize.enable"),
+                                             ConstantAsMetadata::get(builder->getTrue())}));
+    }
+    MDNode* loop_id = MDNode::getDistinct(ctx, operands);
+    loop_id->replaceOperandWith(0, loop_id);
+    latch->setMetadata(LLVMContext::MD_loop, loop_id);
+}
@@ -0,0 +1,313 @@
+#include "../public/codegen.hpp"
+#include <sema/public/type_inference.hpp>
+#include <iostream>
+
+using namespace llvm;
+
+Type* CodeGen::llvm_type(SigType type) {
+    switch (type) {
+        case SigType::U8:
+        case SigType::I8:
+            return Type::getInt8Ty(*context);
+        case SigType::U16:
+        case SigType::I16:
+            return Type::getInt16Ty(*context);
+        case SigType::U64:
+        case SigType::I64:
+            return Type::getInt64Ty(*context);
+        case SigType::Bool:
+            return Type::getInt1Ty(*context);
+        case SigType::Float:
+            return Type::getDoubleTy(*context);
+        case SigType::String:
+        case SigType::Pointer:
+            return PointerType::getUnqual(*context);
+        default:
+            return Type::getInt32Ty(*context);
+    }
+}
+
+// Converts `value` of type `from` to `to`: integers extend by the sign of
+// the source, and anything becomes a bool by comparing against zero.
+// Constants fold, so literals come out already at the target type.
+Value* CodeGen::convert_value(Value* value, SigType from, SigType to) {
+    Type* source = value->getType();
+    Type* target = llvm_type(to);
+
+    if (to == SigType::Bool) {
+        if (source->isIntegerTy(1)) {
+            return value;
+        } else if (source->isDoubleTy()) {
+            return builder->CreateFCmpUNE(value, ConstantFP::get(source, 0.0), "tobool");
+        } else if (source->isIntegerTy()) {
+            return builder->CreateICmpNE(value, Constant::getNullValue(source), "tobool");
+        }
+        return value;
+    }
+
+    if (target->isDoubleTy() && source->isIntegerTy()) {
+        return is_signed_type(from) ? builder->CreateSIToFP(value, target) : builder->CreateUIToFP(value, target);
+    }
+    if (target->isIntegerTy() && source->isDoubleTy()) {
+        return is_signed_type(to) ? builder->CreateFPToSI(value, target) : builder->CreateFPToUI(value, target);
+    }
+    if (target->isIntegerTy() && source->isIntegerTy()) {
+        return is_signed_type(from) ? builder->CreateSExtOrTrunc(value, target) : builder->CreateZExtOrTrunc(value, target);
+    }
+    return value;
+}
+
+Value* CodeGen::codegen_typed(const Expression& expr, SigType type) {
+    Value* value = codegen_expression(expr);
+    if (!value) {
+        return nullptr;
+    }
+    return convert_value(value, expression_type(*ast_arena, expr), type);
+}
+
+// `operand_type` picks the instruction: float, signed or unsigned
+// division, remainder, right shift and ordering. && and || branch, so
+// codegen_short_circuit lowers them instead.
+Value* CodeGen::codegen_operator(SigBinaryOperator op, Value* lhs, Value* rhs, SigType operand_type) {
+    if (operand_type == SigType::Float) {
+        switch (op) {
+            case SigBinaryOperator::Add: return builder->CreateFAdd(lhs, rhs, "add");
+            case SigBinaryOperator::Subtract: return builder->CreateFSub(lhs, rhs, "sub");
+            case SigBinaryOperator::Multiply: return builder->CreateFMul(lhs, rhs, "mul");
+            case SigBinaryOperator::Divide: return builder->CreateFDiv(lhs, rhs, "div");
+            case SigBinaryOperator::Modulo: return builder->CreateFRem(lhs, rhs, "mod");
+            case SigBinaryOperator::Equal: return builder->CreateFCmpOEQ(lhs, rhs, "eq");
+            case SigBinaryOperator::NotEqual: return builder->CreateFCmpUNE(lhs, rhs, "ne");
+            case SigBinaryOperator::LessThan: return builder->CreateFCmpOLT(lhs, rhs, "lt");
+            case SigBinaryOperator::LessThanEqual: return builder->CreateFCmpOLE(lhs, rhs, "le");
+            case SigBinaryOperator::GreaterThan: return builder->CreateFCmpOGT(lhs, rhs, "gt");
+            case SigBinaryOperator::GreaterThanEqual: return builder->CreateFCmpOGE(lhs, rhs, "ge");
+            default:
+                std::cerr << "Error: Unsupported operator for f64 operands" << std::endl;
+                return nullptr;
+        }
+    }
+
+    bool is_signed = is_signed_type(operand_type);
+    switch (op) {
+        case SigBinaryOperator::Add:
+            return builder->CreateAdd(lhs, rhs, "add");
+        case SigBinaryOperator::Subtract:
+            return builder->CreateSub(lhs, rhs, "sub");
+        case SigBinaryOperator::Multiply:
+            return builder->CreateMul(lhs, rhs, "mul");
+        case SigBinaryOperator::Divide:
+            return is_signed ? builder->CreateSDiv(lhs, rhs, "div") : builder->CreateUDiv(lhs, rhs, "div");
+        case SigBinaryOperator::Modulo:
+            return is_signed ? builder->CreateSRem(lhs, rhs, "mod") : builder->CreateURem(lhs, rhs, "mod");
+        case SigBinaryOperator::Equal:
+            return builder->CreateICmpEQ(lhs, rhs, "eq");
+        case SigBinaryOperator::NotEqual:
+            return builder->CreateICmpNE(lhs, rhs, "ne");
+        case SigBinaryOperator::LessThan:
+            return is_signed ? builder->CreateICmpSLT(lhs, rhs, "lt") : builder->CreateICmpULT(lhs, rhs, "lt");
+        case SigBinaryOperator::LessThanEqual:
+            return is_signed ? builder->CreateICmpSLE(lhs, rhs, "le") : builder->CreateICmpULE(lhs, rhs, "le");
+        case SigBinaryOperator::GreaterThan:
+            return is_signed ? builder->CreateICmpSGT(lhs, rhs, "gt") : builder->CreateICmpUGT(lhs, rhs, "gt");
+        case SigBinaryOperator::GreaterThanEqual:
+            return is_signed ? builder->CreateICmpSGE(lhs, rhs, "ge") : builder->CreateICmpUGE(lhs, rhs, "ge");
+        case SigBinaryOperator::BitwiseAnd:
+            return builder->CreateAnd(lhs, rhs, "bitwise_and");
+        case SigBinaryOperator::BitwiseOr:
+            return builder->CreateOr(lhs, rhs, "bitwise_or");
+        case SigBinaryOperator::BitwiseXor:
+            return builder->CreateXor(lhs, rhs, "bitwise_xor");
+        case SigBinaryOperator::LeftShift:
+            return builder->CreateShl(lhs, rhs, "left_shift");
+        case SigBinaryOperator::RightShift:
+            return is_signed ? builder->CreateAShr(lhs, rhs, "right_shift")
+                             : builder->CreateLShr(lhs, rhs, "right_shift");
+        default:
+            std::cerr << "Error: Unsupported binary operator" << std::endl;
+            return nullptr;
+    }
+}
+
+Value* CodeGen::codegen_expr_node(const ExprNode& node) {
+    switch (node.kind) {
+        case ExprKind::Variable: {
+            const Variable* var = variables.find(node.name);
+            if (!var) {
+                std::cerr << "Error: Undefined variable " << name(node.name) << std::endl;
+                return nullptr;
+            }
+            if (is_array_type(var->type) || var->type == SigType::Struct) {
+                std::cerr << "Error: " << name(node.name) << " is an array or struct and cannot be used as a value" << std::endl;
+                return nullptr;
+            }
+            Value* loaded = builder->CreateLoad(llvm_type(var->type), var->slot, name(node.name));
+            return convert_value(loaded, var->type, node.type);
+        }
+        case ExprKind::Index:
+            if (node.type == SigType::Struct) {
+                std::cerr << "Error: An element of " << name(node.name) << " is a struct and cannot be used as a value" << std::endl;
+                return nullptr;
+            }
+            return codegen_array_access(node);
+        case ExprKind::Length:
+            if (const Variable* var = variables.find(node.name); var && var->type == SigType::String) {
+                return string_length(builder->CreateLoad(llvm_type(SigType::String), var->slot, name(node.name)));
+            }
+            return codegen_array_access(node);
+        case ExprKind::Slice:
+            return codegen_array_access(node);
+        case ExprKind::ArrayLiteral:
+            std::cerr << "Error: An array literal can only initialize an array variable" << std::endl;
+            return nullptr;
+        case ExprKind::Field:
+        case ExprKind::ElementField:
+            return codegen_field_access(node);
+        case ExprKind::StructLiteral:
+            std::cerr << "Error: A struct literal can only initialize a struct" << std::endl;
+            return nullptr;
+        case ExprKind::Call:
+            return codegen_call(node);
+        case ExprKind::Unary: {
+            Value* operand = codegen_typed(node.left, node.operand_type);
+            if (!operand) {
+                return nullptr;
+            }
+            return builder->CreateNot(operand, "not");
+        }
+        case ExprKind::Binary: {
+            if (node.op == SigBinaryOperator::And || node.op == SigBinaryOperator::Or) {
+                return codegen_short_circuit(node.op, node.left, node.right);
+            }
+            Value* lhs = codegen_typed(node.left, node.operand_type);
+            Value* rhs = codegen_typed(node.right, node.operand_type);
+            if (!lhs || !rhs) {
+                return nullptr;
+            }
+            return codegen_operator(node.op, lhs, rhs, node.operand_type);
+        }
+    }
+    return nullptr;
+}
+
+// An expression statement; its value is unused
+Value* CodeGen::codegen_binary_expr(const BinaryExpression& expr) {
+    auto typing = type_binary(*ast_arena, expr.operator_type, expr.left, expr.right);
+    if (!typing) {
+        std::cerr << "Error: Invalid operands for binary expression" << std::endl;
+        return nullptr;
+    }
+    if (expr.operator_type == SigBinaryOperator::And || expr.operator_type == SigBinaryOperator::Or) {
+        return codegen_short_circuit(expr.operator_type, expr.left, expr.right);
+    }
+    Value* lhs = codegen_typed(expr.left, typing->operand);
+    Value* rhs = codegen_typed(expr.right, typing->operand);
+    if (!lhs || !rhs) {
+        std::cerr << "Error: Unable to generate code for binary expression operands" << std::endl;
+        return nullptr;
+    }
+    return codegen_operator(expr.operator_type, lhs, rhs, typing->operand);
+}
+
+// && and || evaluate the right side only when the left leaves the result
+// open, so `i < len(a) && a[i] > 0` never reads past the end of a
+Value* CodeGen::codegen_short_circuit(SigBinaryOperator op, const Expression& left, const Expression& right) {
+    Value* lhs = codegen_typed(left, SigType::Bool);
+    if (!lhs) {
+        return nullptr;
+    }
+    bool is_and = op == SigBinaryOperator::And;
+    Function* function = builder->GetInsertBlock()->getParent();
+    BasicBlock* rhs_block = BasicBlock::Create(*context, is_and ? "and.rhs" : "or.rhs", function);
+    BasicBlock* end_block = BasicBlock::Create(*context, is_and ? "and.end" : "or.end");
+    BasicBlock* lhs_end = builder->GetInsertBlock();
+    if (is_and) {
+        builder->CreateCondBr(lhs, rhs_block, end_block);
+    } else {
+        builder->CreateCondBr(lhs, end_block, rhs_block);
+    }
+
+    builder->SetInsertPoint(rhs_block);
+    Value* rhs = codegen_typed(right, SigType::Bool);
+    // The right side may have branched itself (a bounds check, a nested
+    // && or ||), so the phi's edge comes from wherever it ended
+    BasicBlock* rhs_end = builder->GetInsertBlock();
+    builder->CreateBr(end_block);
+
+    end_block->insertInto(function);
+    builder->SetInsertPoint(end_block);
+    if (!rhs) {
+        return nullptr;
+    }
+    PHINode* result = builder->CreatePHI(builder->getInt1Ty(), 2, is_and ? "and" : "or");
+    result->addIncoming(builder->getInt1(!is_and), lhs_end);
+    result->addIncoming(rhs, rhs_end);
+    return result;
+}
+
+Value* CodeGen::codegen_unary_expr(const UnaryExpression& expr) {
+    auto typing = type_unary(*ast_arena, expr.operator_type, expr.operand);
+    if (!typing) {
+        std::cerr << "Error: Unsupported unary operator" << std::endl;
+        return nullptr;
+    }
+    Value* operand = codegen_typed(expr.operand, typing->operand);
+    if (!operand) {
+        std::cerr << "Error: Unable to generate code for unary expression operand" << std::endl;
+        return nullptr;
+    }
+    return builder->CreateNot(operand, "not");
+}
+
+Value* CodeGen::codegen_expression(const Expression& expr) {
+    return std::visit([this](const auto& e) -> Value* {
+        using T = std::decay_t<decltype(e)>;
+
+        if constexpr (std::is_same_v<T, int>) {
+            return ConstantInt::get(Type::getInt32Ty(*context), e);
+        }
+        else if constexpr (std::is_same_v<T, double>) {
+            return ConstantFP::get(Type::getDoubleTy(*context), e);
+        }
+        else if constexpr (std::is_same_v<T, bool>) {
+            return ConstantInt::get(Type::getInt1Ty(*context), e);
+        }
+        else if constexpr (std::is_same_v<T, Symbol>) {
+            return string_constant(name(e));
+        }
+        else if constexpr (std::is_same_v<T, TypedValue>) {
+            // Handle typed values (like hex literals)
+            switch (e.type) {
+                case SigType::U8:
+                    return ConstantInt::get(Type::getInt8Ty(*context), std::get<uint8_t>(e.value));
+                case SigType::U16:
+                    return ConstantInt::get(Type::getInt16Ty(*context), std::get<uint16_t>(e.value));
+                case SigType::U32:
+                    return ConstantInt::get(Type::getInt32Ty(*context), std::get<uint32_t>(e.value));
+                case SigType::U64:
+                    return ConstantInt::get(Type::getInt64Ty(*context), std::get<uint64_t>(e.value));
+                case SigType::I8:
+                    return ConstantInt::get(Type::getInt8Ty(*context), std::get<int8_t>(e.value));
+                case SigType::I16:
+                    return ConstantInt::get(Type::getInt16Ty(*context), std::get<int16_t>(e.value));
+                case SigType::I32:
+                    return ConstantInt::get(Type::getInt32Ty(*context), std::get<int32_t>(e.value));
+                case SigType::I64:
+                    return ConstantInt::get(Type::getInt64Ty(*context), std::get<int64_t>(e.value));
+                case SigType::Bool:
+                    return ConstantInt::get(Type::getInt1Ty(*context), std::get<bool>(e.value));
+                case SigType::Float:
+                    return ConstantFP::get(Type::getDoubleTy(*context), std::get<double>(e.value));
+                case SigType::String:
+                    return string_constant(std::get<std::string>(e.value));
+                default:
+                    return nullptr;
+            }
+        }
+        else if constexpr (std::is_same_v<T, ExprRef>) {
+            return codegen_expr_node(ast_arena->expression(e));
+        }
+
+        return nullptr;
+    }, expr);
+}
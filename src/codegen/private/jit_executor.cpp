@@ -1,10 +1,176 @@
 #include "../public/codegen.hpp"
+#include "../public/target_context.hpp"
+#include "../public/tiered_jit.hpp"
+#include <cache/public/object_cache.hpp>
+#include <runtime/output.hpp>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
 #include <iostream>
+#include <cstdlib>
+#include <mutex>
 
 using namespace llvm;
 
+// Lazy stubs jump here when the function behind them fails to compile;
+// ORC has already reported why
+static void lazy_compile_failure() {
+    std::cerr << "Error: JIT compilation of a called function failed" << std::endl;
+    std::exit(1);
+}
+
+// The compiler carries its own copy of the output runtime, but does not
+// export it where the process symbol generator would look
+orc::SymbolMap CodeGen::runtime_symbols(orc::LLJIT& target_jit) {
+    orc::SymbolMap symbols;
+    auto add = [&](const char* symbol_name, auto* function) {
+        symbols[target_jit.mangleAndIntern(symbol_name)] = orc::ExecutorSymbolDef(
+            orc::ExecutorAddr::fromPtr(function), JITSymbolFlags::Exported | JITSymbolFlags::Callable);
+    };
+    add("sig_write_i32", &sig_write_i32);
+    add("sig_write_i64", &sig_write_i64);
+    add("sig_write_u64", &sig_write_u64);
+    add("sig_write_f64", &sig_write_f64);
+    add("sig_write_bool", &sig_write_bool);
+    add("sig_write_str", &sig_write_str);
+    add("sig_write_newline", &sig_write_newline);
+    add("sig_flush", &sig_flush);
+    add("sig_index_out_of_bounds", &sig_index_out_of_bounds);
+    return symbols;
+}
+
 void CodeGen::execute() {
+    TargetContext& Targets = TargetContext::instance();
+    TargetConfig config;
+    config.triple = sys::getProcessTriple();
+    config.opt_level = codegen_opt_level();
+    config.jit = true;
+    if (!target_cpu.empty()) {
+        config.cpu = target_cpu;
+        config.features = target_features;
+    } else {
+        // -mattr alone adjusts the detected host features
+        config.cpu = Targets.host_cpu();
+        config.features = Targets.host_features();
+        if (!target_features.empty()) {
+            config.features += "," + target_features;
+        }
+    }
+    
+    std::string Error;
+    TargetMachine* Machine = Targets.target_machine(config, Error);
+    if (!Machine) {
+        std::cerr << "Failed to create target machine: " << Error << std::endl;
+        return;
+    }
+    
+    if (tiered_jit) {
+        // Tiers pick their own opt levels; the module only needs the
+        // CPU attributes both share. Tier objects are not cached.
+        annotate_for_target(*Machine);
+        TieredJIT Tiered(std::move(context), std::move(module), config,
+                         tier_threshold ? tier_threshold : TieredJIT::default_threshold);
+        int result = 0;
+        // The program writes to fd 1 directly, past stdio's buffer
+        std::cout.flush();
+        if (!Tiered.run(result)) {
+            return;
+        }
+        sig_flush();
+        std::cout << "Program exited with code: " << result << std::endl;
+        if (jit_stats) {
+            Tiered.dump_stats(std::cerr);
+        }
+        return;
+    }
+    
+    // Objects are cached under the unoptimized IR plus everything that
+    // shapes the code; the machine's opt level follows from the IR level
+    JitObjectCache* Cache = object_cache && object_cache->enabled() ? object_cache : nullptr;
+    std::string CacheConfig = config.triple + ";" + config.cpu + ";" + config.features + ";O" +
+                              std::to_string(opt_level) + (optimize_size ? "s" : "");
+    
+    // Optimize with the same machine the JIT generates code with. On a
+    // single thread the JIT compiles with that machine too instead of
+    // building its own. With compile threads ORC clones every module into a
+    // fresh context and compiles them concurrently, so it gets an equivalent
+    // builder and creates a machine per compile.
+    orc::JITTargetMachineBuilder JTMB(Machine->getTargetTriple());
+    JTMB.setCPU(config.cpu);
+    JTMB.addFeatures(SubtargetFeatures(config.features).getFeatures());
+    JTMB.setCodeGenOptLevel(config.opt_level);
+    auto configure = [&](auto& Builder) {
+        Builder.setJITTargetMachineBuilder(JTMB)
+            .setDataLayout(Machine->createDataLayout())
+            .setNumCompileThreads(jit_threads);
+        if (jit_threads == 0) {
+            Builder.setCompileFunctionCreator([Machine, Cache](orc::JITTargetMachineBuilder)
+                                                  -> Expected<std::unique_ptr<orc::IRCompileLayer::IRCompiler>> {
+                return std::make_unique<orc::SimpleCompiler>(*Machine, Cache);
+            });
+        } else if (Cache) {
+            Builder.setCompileFunctionCreator([Cache](orc::JITTargetMachineBuilder JTMB)
+                                                  -> Expected<std::unique_ptr<orc::IRCompileLayer::IRCompiler>> {
+                return std::make_unique<orc::ConcurrentIRCompiler>(std::move(JTMB), Cache);
+            });
+        }
+    };
+    
+    orc::LLLazyJIT* LazyJIT = nullptr;
+    if (lazy_jit) {
+        // Functions are optimized one partition at a time as they are first
+        // called, so nothing is inlined across functions in this mode
+        annotate_for_target(*Machine);
+        
+        orc::LLLazyJITBuilder Builder;
+        configure(Builder);
+        Builder.setLazyCompileFailureAddr(orc::ExecutorAddr::fromPtr(&lazy_compile_failure));
+        auto JIT = Builder.create();
+        if (!JIT) {
+            std::cerr << "Failed to create JIT: " << toString(JIT.takeError()) << std::endl;
+            return;
+        }
+        LazyJIT = JIT->get();
+        // Modules are split per function up front, so each one is
+        // compiled whole the first time one of its symbols is called
+        LazyJIT->setPartitionFunction(orc::CompileOnDemandLayer::compileWholeModule);
+        // The shared machine caches subtargets without locking, so
+        // partitions on different compile threads take turns optimizing
+        auto OptimizeMutex = std::make_shared<std::mutex>();
+        LazyJIT->getIRTransformLayer().setTransform(
+            [this, Machine, OptimizeMutex, Cache, CacheConfig](orc::ThreadSafeModule TSM,
+                                                                orc::MaterializationResponsibility&)
+                -> Expected<orc::ThreadSafeModule> {
+                std::lock_guard<std::mutex> lock(*OptimizeMutex);
+                TSM.withModuleDo([&](Module& M) {
+                    if (!Cache || !Cache->tag(M, CacheConfig)) {
+                        optimize_module(M, *Machine);
+                    }
+                });
+                return std::move(TSM);
+            });
+        jit = std::move(*JIT);
+    } else {
+        // Tagged after the runtime is linked in, so its bitcode is part
+        // of the key. A cached object makes optimizing pointless; the
+        // compiler loads it in place of running codegen.
+        annotate_for_target(*Machine);
+        if (!Cache || !Cache->tag(*module, CacheConfig)) {
+            optimize_module(*module, *Machine);
+        }
+        
+        orc::LLJITBuilder Builder;
+        configure(Builder);
+        auto JIT = Builder.create();
+        if (!JIT) {
+            std::cerr << "Failed to create JIT: " << toString(JIT.takeError()) << std::endl;
+            return;
+        }
+        jit = std::move(*JIT);
+    }
+    
     auto ProcessSymsGenerator = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
         jit->getDataLayout().getGlobalPrefix());
     if (!ProcessSymsGenerator) {
@@ -13,10 +179,27 @@ void CodeGen::execute() {
         return;
     }
     jit->getMainJITDylib().addGenerator(std::move(*ProcessSymsGenerator));
+    if (auto Err = jit->getMainJITDylib().define(orc::absoluteSymbols(runtime_symbols(*jit)))) {
+        std::cerr << "Failed to define runtime symbols: " << toString(std::move(Err)) << std::endl;
+        return;
+    }
+    
+    std::vector<std::unique_ptr<Module>> Parts;
+    if (LazyJIT) {
+        Parts = split_by_function(*module);
+    }
+    orc::ThreadSafeContext TSCtx(std::move(context));
+    for (auto& Part : Parts) {
+        if (auto Err = LazyJIT->addLazyIRModule(orc::ThreadSafeModule(std::move(Part), TSCtx))) {
+            std::cerr << "Failed to add module: " << toString(std::move(Err)) << std::endl;
+            return;
+        }
+    }
     
-    auto TSM = orc::ThreadSafeModule(std::move(module), std::move(context));
+    auto TSM = orc::ThreadSafeModule(std::move(module), TSCtx);
     
-    if (auto Err = jit->addIRModule(std::move(TSM))) {
+    auto Err = LazyJIT ? LazyJIT->addLazyIRModule(std::move(TSM)) : jit->addIRModule(std::move(TSM));
+    if (Err) {
         std::cerr << "Failed to add module: " << toString(std::move(Err)) << std::endl;
         return;
     }
@@ -28,12 +211,23 @@ void CodeGen::execute() {
     }
     
     auto MainFunc = (int(*)())MainSym->getValue();
+    // The program writes to fd 1 directly, past stdio's buffer
+    std::cout.flush();
     int result = MainFunc();
+    // The program's output is still buffered when main returns here
+    sig_flush();
     std::cout << "Program exited with code: " << result << std::endl;
 }
 
 void CodeGen::dump_ir() {
     if (module) {
+        if (opt_level > 0 || optimize_size || !target_cpu.empty() || !target_features.empty()) {
+            auto TargetMachine = create_target_machine();
+            if (!TargetMachine) {
+                return;
+            }
+            prepare_for_target(*TargetMachine);
+        }
         module->print(outs(), nullptr);
     } else {
         std::cerr << "Error: Module has been moved or is null" << std::endl;
@@ -0,0 +1,159 @@
+#include "../public/codegen.hpp"
+#include <lld/Common/Driver.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Triple.h>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+LLD_HAS_DRIVER(elf)
+
+using namespace llvm;
+
+namespace {
+
+// What the link needs to know about a target's C library
+struct LinkTarget {
+    const char* emulation;
+    const char* dynamic_linker;
+    std::vector<const char*> library_dirs;  // searched in order for crt1.o
+    const char* runtime_archive;
+    // GCC target directories under /usr/lib/gcc, each with the multilib
+    // subdirectory holding this target's libgcc.a
+    std::vector<std::pair<const char*, const char*>> gcc_dirs;
+};
+
+}  // namespace
+
+static bool link_target_for(const Triple& triple, LinkTarget& target) {
+    switch (triple.getArch()) {
+        case Triple::x86_64:
+            target = {"elf_x86_64", "/lib64/ld-linux-x86-64.so.2",
+                      {"/usr/lib/x86_64-linux-gnu", "/lib/x86_64-linux-gnu", "/usr/lib64", "/lib64", "/usr/lib"},
+                      "libsig_runtime.a",
+                      {{"x86_64-linux-gnu", ""}, {"x86_64-redhat-linux", ""}, {"x86_64-pc-linux-gnu", ""}}};
+            return true;
+        case Triple::x86:
+            target = {"elf_i386", "/lib/ld-linux.so.2",
+                      {"/usr/lib/i386-linux-gnu", "/lib/i386-linux-gnu", "/usr/lib32", "/lib32", "/usr/lib"},
+                      "libsig_runtime32.a",
+                      {{"i686-linux-gnu", ""}, {"i386-linux-gnu", ""}, {"x86_64-linux-gnu", "32"},
+                       {"x86_64-redhat-linux", "32"}, {"x86_64-pc-linux-gnu", "32"}}};
+            return true;
+        case Triple::aarch64:
+            target = {"aarch64linux", "/lib/ld-linux-aarch64.so.1",
+                      {"/usr/lib/aarch64-linux-gnu", "/lib/aarch64-linux-gnu", "/usr/lib64", "/usr/lib"},
+                      "libsig_runtime.a",
+                      {{"aarch64-linux-gnu", ""}, {"aarch64-redhat-linux", ""}}};
+            return true;
+        default:
+            return false;
+    }
+}
+
+// GCC's support library, with the helpers compiled code calls for what
+// the target lacks, such as 64-bit division on i386. The newest GCC
+// version installed wins; empty if there is none.
+static std::string find_libgcc(const LinkTarget& target) {
+    std::string found;
+    unsigned found_version = 0;
+    for (const auto& [gcc_dir, multilib] : target.gcc_dirs) {
+        SmallString<128> root("/usr/lib/gcc");
+        sys::path::append(root, gcc_dir);
+        std::error_code ec;
+        for (sys::fs::directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+            StringRef version = sys::path::filename(it->path());
+            unsigned major = 0;
+            if (version.consumeInteger(10, major) || (!found.empty() && major <= found_version)) {
+                continue;
+            }
+            SmallString<256> archive(it->path());
+            sys::path::append(archive, multilib, "libgcc.a");
+            if (sys::fs::exists(archive)) {
+                found = archive.str().str();
+                found_version = major;
+            }
+        }
+    }
+    return found;
+}
+
+// The runtime's archives and bitcode are installed next to the compiler:
+// beside the executable in a build tree, or in ../lib/sig once installed
+std::string CodeGen::find_runtime_file(const char* name) {
+    std::string executable = sys::fs::getMainExecutable(nullptr, nullptr);
+    SmallString<256> bin_dir = sys::path::parent_path(executable);
+
+    SmallString<256> candidate = bin_dir;
+    sys::path::append(candidate, name);
+    if (sys::fs::exists(candidate)) {
+        return candidate.str().str();
+    }
+    candidate = sys::path::parent_path(bin_dir);
+    sys::path::append(candidate, "lib", "sig", name);
+    if (sys::fs::exists(candidate)) {
+        return candidate.str().str();
+    }
+    return "";
+}
+
+// Links `object_file` with the runtime archive and the C library into
+// `output_name` using the LLD library, so no external compiler or linker
+// is run
+bool CodeGen::link_executable(const std::string& object_file, const std::string& output_name) {
+    Triple triple(module->getTargetTriple());
+    LinkTarget target;
+    if (!triple.isOSLinux() || !link_target_for(triple, target)) {
+        std::cerr << "Error: Linking executables for " << triple.str() << " is not supported" << std::endl;
+        return false;
+    }
+
+    std::string runtime = find_runtime_file(target.runtime_archive);
+    if (runtime.empty()) {
+        std::cerr << "Error: Could not find " << target.runtime_archive << " next to the compiler" << std::endl;
+        return false;
+    }
+
+    std::string library_dir;
+    for (const char* dir : target.library_dirs) {
+        SmallString<256> crt1(dir);
+        sys::path::append(crt1, "crt1.o");
+        if (sys::fs::exists(crt1)) {
+            library_dir = dir;
+            break;
+        }
+    }
+    if (library_dir.empty()) {
+        std::cerr << "Error: Could not find the C library startup files (crt1.o) for " << triple.str() << std::endl;
+        return false;
+    }
+
+    // Same layout a C compiler driver passes for a non-PIE executable. The
+    // runtime is C++ built to need nothing from libstdc++: its thread_local
+    // buffer is trivially destructible and its exit flush is a .fini_array
+    // entry, so crtbegin/crtend are not needed. Its thread-exit flush uses
+    // pthread keys, which glibc before 2.34 keeps in libpthread. libgcc
+    // comes last: the program and the C library may both call its helpers.
+    std::string crt1 = library_dir + "/crt1.o";
+    std::string crti = library_dir + "/crti.o";
+    std::string crtn = library_dir + "/crtn.o";
+    std::string search_dir = "-L" + library_dir;
+    std::string libgcc = find_libgcc(target);
+    std::vector<const char*> args = {
+        "ld.lld", "-m", target.emulation, "--eh-frame-hdr", "-dynamic-linker", target.dynamic_linker,
+        "-o", output_name.c_str(), crt1.c_str(), crti.c_str(), search_dir.c_str(),
+        object_file.c_str(), runtime.c_str(), "-lpthread", "-lm", "-lc",
+    };
+    if (!libgcc.empty()) {
+        args.push_back(libgcc.c_str());
+    } else if (triple.getArch() == Triple::x86) {
+        std::cerr << "Warning: libgcc.a for " << triple.str()
+                  << " not found; 64-bit division will not link (install gcc-multilib)" << std::endl;
+    }
+    args.push_back(crtn.c_str());
+
+    lld::Result result = lld::lldMain(args, outs(), errs(), {{lld::Gnu, &lld::elf::link}});
+    return result.retCode == 0;
+}
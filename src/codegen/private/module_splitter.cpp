@@ -0,0 +1,130 @@
+#include "../public/codegen.hpp"
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+
+using namespace llvm;
+
+// Adds every global `value` refers to, looking through constant expressions
+// and aggregates. Kept in first-use order so a part's layout, and with it the
+// JIT object cache key, is the same on every run.
+static void collect_globals(Value* value, SetVector<GlobalValue*>& globals,
+                            SmallPtrSetImpl<Constant*>& visited) {
+    if (auto* global = dyn_cast<GlobalValue>(value)) {
+        globals.insert(global);
+    } else if (auto* constant = dyn_cast<Constant>(value)) {
+        if (!visited.insert(constant).second) {
+            return;
+        }
+        for (Value* operand : constant->operands()) {
+            collect_globals(operand, globals, visited);
+        }
+    }
+}
+
+// True if `var` can move along with `function`: nothing else refers to it
+// and its initializer refers to nothing
+static bool private_to(GlobalVariable* var, Function* function) {
+    if (!var->hasLocalLinkage()) {
+        return false;
+    }
+    for (User* user : var->users()) {
+        auto* inst = dyn_cast<Instruction>(user);
+        if (!inst || inst->getFunction() != function) {
+            return false;
+        }
+    }
+    SetVector<GlobalValue*> referenced;
+    SmallPtrSet<Constant*, 4> visited;
+    if (var->hasInitializer()) {
+        collect_globals(var->getInitializer(), referenced, visited);
+    }
+    return referenced.empty();
+}
+
+// Moves every defined function except main into a module of its own, in the
+// same context, leaving a declaration behind. Globals used by one function
+// only move with it; shared ones are made linkable and declared where used.
+// The work is proportional to the size of the IR, unlike ORC's per-call
+// partitioning, which round-trips the whole module through bitcode for
+// every function it extracts.
+std::vector<std::unique_ptr<Module>> CodeGen::split_by_function(Module& source) {
+    std::vector<Function*> definitions;
+    for (Function& F : source) {
+        if (!F.isDeclaration() && F.getName() != "main") {
+            definitions.push_back(&F);
+        }
+    }
+
+    std::vector<std::unique_ptr<Module>> parts;
+    for (Function* F : definitions) {
+        auto part = std::make_unique<Module>(source.getModuleIdentifier() + "." + F->getName().str(),
+                                             source.getContext());
+        part->setTargetTriple(source.getTargetTriple());
+        part->setDataLayout(source.getDataLayout());
+
+        // Callers left in this module, recursive calls included, now go
+        // through the declaration
+        Function* declaration = Function::Create(F->getFunctionType(), GlobalValue::ExternalLinkage, "", source);
+        declaration->setCallingConv(F->getCallingConv());
+        declaration->setAttributes(F->getAttributes());
+        F->replaceAllUsesWith(declaration);
+        declaration->takeName(F);
+        F->removeFromParent();
+        part->getFunctionList().push_back(F);
+        F->setName(declaration->getName());
+        if (F->hasLocalLinkage()) {
+            F->setLinkage(GlobalValue::ExternalLinkage);
+        }
+
+        SetVector<GlobalValue*> globals;
+        SmallPtrSet<Constant*, 16> visited;
+        for (Instruction& I : instructions(*F)) {
+            for (Value* operand : I.operands()) {
+                collect_globals(operand, globals, visited);
+            }
+        }
+
+        ValueToValueMapTy remap;
+        for (GlobalValue* global : globals) {
+            if (global == declaration) {
+                remap[global] = F;
+                continue;
+            }
+            auto* var = dyn_cast<GlobalVariable>(global);
+            if (var && private_to(var, F)) {
+                var->removeFromParent();
+                part->insertGlobalVariable(var);
+                continue;
+            }
+
+            if (global->hasLocalLinkage()) {
+                global->setLinkage(GlobalValue::ExternalLinkage);
+            }
+            if (!global->hasName()) {
+                global->setName("sig.shared");
+            }
+            if (auto* callee = dyn_cast<Function>(global)) {
+                Function* callee_declaration = Function::Create(callee->getFunctionType(), GlobalValue::ExternalLinkage,
+                                                                callee->getName(), *part);
+                callee_declaration->setCallingConv(callee->getCallingConv());
+                callee_declaration->setAttributes(callee->getAttributes());
+                remap[global] = callee_declaration;
+            } else {
+                auto* shared = cast<GlobalVariable>(global);
+                auto* var_declaration = new GlobalVariable(*part, shared->getValueType(), shared->isConstant(),
+                                                           GlobalValue::ExternalLinkage, nullptr, shared->getName());
+                var_declaration->setAlignment(shared->getAlign());
+                remap[global] = var_declaration;
+            }
+        }
+        for (Instruction& I : instructions(*F)) {
+            RemapInstruction(&I, remap, RF_IgnoreMissingLocals);
+        }
+
+        parts.push_back(std::move(part));
+    }
+    return parts;
+}
@@ -1,46 +1,67 @@
 #include "../public/codegen.hpp"
+#include "../public/target_context.hpp"
 #include <llvm/Support/FileSystem.h>
-#include <llvm/MC/TargetRegistry.h>
-#include <llvm/Target/TargetOptions.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/IR/LegacyPassManager.h>
-#include <llvm/TargetParser/Triple.h>
 #include <iostream>
-#include <cstdlib>
 
 using namespace llvm;
 
+TargetMachine* CodeGen::create_target_machine() {
+    // Use the target triple already configured in the module
+    TargetConfig config;
+    config.triple = module->getTargetTriple();
+    config.cpu = target_cpu.empty() ? "generic" : target_cpu;
+    config.features = target_features;
+    config.opt_level = codegen_opt_level();
+    
+    std::string Error;
+    TargetMachine* Machine = TargetContext::instance().target_machine(config, Error);
+    if (!Machine) {
+        std::cerr << "Error: " << Error << std::endl;
+    }
+    return Machine;
+}
+
+// Lays out the module for `target_machine`, links in the runtime's bitcode
+// so its builtins can be inlined, and annotates every function
+void CodeGen::annotate_for_target(TargetMachine& target_machine) {
+    module->setDataLayout(target_machine.createDataLayout());
+    link_runtime_bitcode();
+    
+    // Per-function attributes are what the vectorizers' cost models and the
+    // backend's subtarget selection actually read
+    StringRef CPU = target_machine.getTargetCPU();
+    StringRef Features = target_machine.getTargetFeatureString();
+    for (Function& F : *module) {
+        if (F.isDeclaration()) {
+            continue;
+        }
+        F.addFnAttr("target-cpu", CPU);
+        if (!Features.empty()) {
+            F.addFnAttr("target-features", Features);
+        }
+    }
+}
+
+// Annotates the module, then optimizes it as a whole
+void CodeGen::prepare_for_target(TargetMachine& target_machine) {
+    annotate_for_target(target_machine);
+    optimize_module(*module, target_machine);
+}
+
 void CodeGen::create_executable(const std::string& output_name) {
     if (!module) {
         std::cerr << "Error: No module compiled" << std::endl;
         return;
     }
     
-    InitializeAllTargetInfos();
-    InitializeAllTargets();
-    InitializeAllTargetMCs();
-    InitializeAllAsmParsers();
-    InitializeAllAsmPrinters();
-    
-    // Use the target triple already configured in the module
-    auto TargetTriple = module->getTargetTriple();
-    
-    std::string Error;
-    auto Target = TargetRegistry::lookupTarget(TargetTriple, Error);
-    
-    if (!Target) {
-        std::cerr << "Error: " << Error << std::endl;
+    auto TargetMachine = create_target_machine();
+    if (!TargetMachine) {
         return;
     }
     
-    auto CPU = "generic";
-    auto Features = "";
-    
-    TargetOptions opt;
-    auto RM = std::optional<Reloc::Model>();
-    auto TargetMachine = Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM);
-    
-    module->setDataLayout(TargetMachine->createDataLayout());
+    prepare_for_target(*TargetMachine);
     
     std::string obj_filename = output_name + ".o";
     std::error_code EC;
@@ -64,24 +85,7 @@ void CodeGen::create_executable(const std::string& output_name) {
     
     std::cout << "Object file created: " << obj_filename << std::endl;
     
-    // Create builtin functions object file 
-    std::string builtin_obj = "sig_runtime.o";
-    
-    // Get current working directory and find the src path
-    std::string create_runtime_cmd = "gcc -c src/runtime/builtin_functions.cpp -o " + builtin_obj;
-    if (target_32bit) {
-        create_runtime_cmd = "gcc -m32 -c src/runtime/builtin_functions.cpp -o " + builtin_obj;
-    }
-    std::system(create_runtime_cmd.c_str());
-    
-    std::string link_command = "gcc -no-pie";
-    if (target_32bit) {
-        link_command += " -m32";
-    }
-    link_command += " -o " + output_name + " " + obj_filename + " " + builtin_obj + " -lm";
-    int result = std::system(link_command.c_str());
-    
-    if (result == 0) {
+    if (link_executable(obj_filename, output_name)) {
         std::cout << "Executable created: " << output_name << std::endl;
         std::cout << "Object file retained: " << obj_filename << std::endl;
         // Keep object file for debugging or further linking
@@ -97,30 +101,12 @@ void CodeGen::create_object_file(const std::string& output_name) {
         return;
     }
     
-    InitializeAllTargetInfos();
-    InitializeAllTargets();
-    InitializeAllTargetMCs();
-    InitializeAllAsmParsers();
-    InitializeAllAsmPrinters();
-    
-    auto TargetTriple = module->getTargetTriple();
-    
-    std::string Error;
-    auto Target = TargetRegistry::lookupTarget(TargetTriple, Error);
-    
-    if (!Target) {
-        std::cerr << "Error: " << Error << std::endl;
+    auto TargetMachine = create_target_machine();
+    if (!TargetMachine) {
         return;
     }
     
-    auto CPU = "generic";
-    auto Features = "";
-    
-    TargetOptions opt;
-    auto RM = std::optional<Reloc::Model>();
-    auto TargetMachine = Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM);
-    
-    module->setDataLayout(TargetMachine->createDataLayout());
+    prepare_for_target(*TargetMachine);
     
     std::error_code EC;
     raw_fd_ostream dest(output_name, EC, sys::fs::OF_None);
@@ -0,0 +1,57 @@
+#include "../public/codegen.hpp"
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/Analysis/CGSCCPassManager.h>
+#include <llvm/IR/PassManager.h>
+
+using namespace llvm;
+
+CodeGenOptLevel CodeGen::codegen_opt_level() const {
+    // -Os keeps the default backend level; size is traded off in the IR pipeline
+    if (optimize_size) {
+        return CodeGenOptLevel::Default;
+    }
+    switch (opt_level) {
+        case 0: return CodeGenOptLevel::None;
+        case 1: return CodeGenOptLevel::Less;
+        case 2: return CodeGenOptLevel::Default;
+        default: return CodeGenOptLevel::Aggressive;
+    }
+}
+
+void CodeGen::optimize_module(Module& target_module, TargetMachine& target_machine) {
+    optimize(target_module, target_machine, opt_level, optimize_size);
+}
+
+void CodeGen::optimize(Module& target_module, TargetMachine& target_machine, unsigned opt_level, bool optimize_size) {
+    if (opt_level == 0 && !optimize_size) {
+        return;
+    }
+
+    OptimizationLevel level = OptimizationLevel::O3;
+    if (optimize_size) {
+        level = OptimizationLevel::Os;
+    } else if (opt_level == 1) {
+        level = OptimizationLevel::O1;
+    } else if (opt_level == 2) {
+        level = OptimizationLevel::O2;
+    }
+
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+
+    // Passing the TargetMachine gives the pipeline real cost models for
+    // inlining, unrolling and vectorization
+    PassBuilder PB(&target_machine);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(level);
+    MPM.run(target_module, MAM);
+}
@@ -1,10 +1,17 @@
 #include "../public/codegen.hpp"
+#include "../public/target_context.hpp"
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/MC/TargetRegistry.h>
+#include <llvm/MC/MCSubtargetInfo.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/TargetParser/Triple.h>
 #include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Transforms/IPO/Internalize.h>
 #include <iostream>
 #include <cmath>
 #include <string>
@@ -14,67 +21,34 @@ using namespace llvm;
 
 CodeGen::CodeGen() : target_32bit(false), no_std(false)
 {
-    InitializeNativeTarget();
-    InitializeNativeTargetAsmPrinter();
-
     context = std::make_unique<LLVMContext>();
     module = std::make_unique<Module>("sig_module", *context);
     builder = std::make_unique<IRBuilder<>>(*context);
 
     configure_target_architecture();
 
-    auto JIT = orc::LLJITBuilder().create();
-    if (!JIT)
-    {
-        std::cerr << "Failed to create JIT: " << toString(JIT.takeError()) << std::endl;
-        exit(1);
-    }
-    jit = std::move(*JIT);
-
     setup_runtime_functions();
 }
 
 CodeGen::CodeGen(bool target_32bit) : target_32bit(target_32bit), no_std(false)
 {
-    InitializeNativeTarget();
-    InitializeNativeTargetAsmPrinter();
-
     context = std::make_unique<LLVMContext>();
     module = std::make_unique<Module>("sig_module", *context);
     builder = std::make_unique<IRBuilder<>>(*context);
 
     configure_target_architecture();
 
-    auto JIT = orc::LLJITBuilder().create();
-    if (!JIT)
-    {
-        std::cerr << "Failed to create JIT: " << toString(JIT.takeError()) << std::endl;
-        exit(1);
-    }
-    jit = std::move(*JIT);
-
     setup_runtime_functions();
 }
 
 CodeGen::CodeGen(bool target_32bit, bool no_std) : target_32bit(target_32bit), no_std(no_std)
 {
-    InitializeNativeTarget();
-    InitializeNativeTargetAsmPrinter();
-
     context = std::make_unique<LLVMContext>();
     module = std::make_unique<Module>("sig_module", *context);
     builder = std::make_unique<IRBuilder<>>(*context);
 
     configure_target_architecture();
 
-    auto JIT = orc::LLJITBuilder().create();
-    if (!JIT)
-    {
-        std::cerr << "Failed to create JIT: " << toString(JIT.takeError()) << std::endl;
-        exit(1);
-    }
-    jit = std::move(*JIT);
-
     if (!no_std) {
         setup_runtime_functions();
     }
@@ -112,19 +86,97 @@ void CodeGen::configure_target_architecture()
     }
 }
 
+void CodeGen::set_target_cpu(const std::string& cpu, const std::string& features)
+{
+    SubtargetFeatures feature_list;
+
+    if (cpu == "native")
+    {
+        target_cpu = TargetContext::instance().host_cpu();
+        feature_list = SubtargetFeatures(TargetContext::instance().host_features());
+    }
+    else
+    {
+        target_cpu = cpu;
+    }
+
+    // Reject unknown CPUs up front instead of letting LLVM warn and fall
+    // back to a generic subtarget
+    if (!target_cpu.empty())
+    {
+        std::string error;
+        const Target* target = TargetContext::instance().lookup_target(module->getTargetTriple(), error);
+        if (target)
+        {
+            std::unique_ptr<MCSubtargetInfo> subtarget(
+                target->createMCSubtargetInfo(module->getTargetTriple(), "", ""));
+            if (!subtarget->isCPUStringValid(target_cpu))
+            {
+                std::cerr << "Error: Unknown CPU '" << target_cpu << "' for target "
+                          << module->getTargetTriple() << std::endl;
+                exit(1);
+            }
+        }
+    }
+
+    // Explicit -mattr entries come last so they override detected ones;
+    // a bare name such as "avx2" means "+avx2"
+    SmallVector<StringRef, 8> requested;
+    StringRef(features).split(requested, ',', -1, false);
+    for (StringRef feature : requested)
+    {
+        feature_list.AddFeature(feature.trim());
+    }
+
+    target_features = feature_list.getString();
+}
+
+// Looks up an entry point made by setup_runtime_functions() without adding
+// a null entry for a name that is missing, as with --no-std
+Function *CodeGen::runtime_function(const char *function_name)
+{
+    auto found = functions.find(function_name);
+    return found != functions.end() ? found->second : nullptr;
+}
+
 void CodeGen::setup_runtime_functions()
 {
-    // printf for formatted output
-    std::vector<Type *> printf_args = {PointerType::getUnqual(*context)};
-    FunctionType *printf_type = FunctionType::get(Type::getInt32Ty(*context), printf_args, true);
-    Function *printf_func = Function::Create(printf_type, Function::ExternalLinkage, "printf", *module);
-    functions["printf"] = printf_func;
-
-    // puts for simple strings
-    std::vector<Type *> puts_args = {PointerType::getUnqual(*context)};
-    FunctionType *puts_type = FunctionType::get(Type::getInt32Ty(*context), puts_args, false);
-    Function *puts_func = Function::Create(puts_type, Function::ExternalLinkage, "puts", *module);
-    functions["puts"] = puts_func;
+    // Buffered output (runtime/output.hpp); print and println go through these
+    Type *void_type = Type::getVoidTy(*context);
+    const std::pair<const char *, Type *> writers[] = {
+        {"sig_write_i32", Type::getInt32Ty(*context)},
+        {"sig_write_i64", Type::getInt64Ty(*context)},
+        {"sig_write_u64", Type::getInt64Ty(*context)},
+        {"sig_write_f64", Type::getDoubleTy(*context)},
+        {"sig_write_bool", Type::getInt32Ty(*context)},
+        {"sig_write_str", PointerType::getUnqual(*context)},
+    };
+    for (const auto &[writer_name, value_type] : writers)
+    {
+        FunctionType *writer_type = FunctionType::get(void_type, {value_type}, false);
+        Function *writer = Function::Create(writer_type, Function::ExternalLinkage, writer_name, *module);
+        writer->addFnAttr(Attribute::NoUnwind);
+        functions[writer_name] = writer;
+    }
+    FunctionType *no_args_type = FunctionType::get(void_type, false);
+    Function *newline_func = Function::Create(no_args_type, Function::ExternalLinkage, "sig_write_newline", *module);
+    newline_func->addFnAttr(Attribute::NoUnwind);
+    functions["sig_write_newline"] = newline_func;
+
+    // flush() - writes out buffered output now
+    Function *flush_func = Function::Create(no_args_type, Function::ExternalLinkage, "sig_flush", *module);
+    flush_func->addFnAttr(Attribute::NoUnwind);
+    functions["flush"] = flush_func;
+
+    // Reached only from failed array bounds checks, which --no-std turns
+    // into traps instead
+    Type *int64_type = Type::getInt64Ty(*context);
+    FunctionType *bounds_type = FunctionType::get(void_type, {int64_type, int64_type}, false);
+    Function *bounds_func = Function::Create(bounds_type, Function::ExternalLinkage, "sig_index_out_of_bounds", *module);
+    bounds_func->addFnAttr(Attribute::NoReturn);
+    bounds_func->addFnAttr(Attribute::NoUnwind);
+    bounds_func->addFnAttr(Attribute::Cold);
+    functions["sig_index_out_of_bounds"] = bounds_func;
 
     // input(prompt) - reads a line from stdin, prints prompt first
     std::vector<Type *> input_args = {PointerType::getUnqual(*context)};
@@ -138,27 +190,84 @@ void CodeGen::setup_runtime_functions()
     Function *len_func = Function::Create(len_type, Function::ExternalLinkage, "sig_len", *module);
     functions["len"] = len_func;
 
-    // abs(number) - absolute value of a number
-    std::vector<Type *> abs_args = {Type::getDoubleTy(*context)};
-    FunctionType *abs_type = FunctionType::get(Type::getDoubleTy(*context), abs_args, false);
-    Function *abs_func = Function::Create(abs_type, Function::ExternalLinkage, "sig_abs", *module);
-    functions["abs"] = abs_func;
-
-    // sqrt(number) - square root of a number
-    std::vector<Type *> sqrt_args = {Type::getDoubleTy(*context)};
-    FunctionType *sqrt_type = FunctionType::get(Type::getDoubleTy(*context), sqrt_args, false);
-    Function *sqrt_func = Function::Create(sqrt_type, Function::ExternalLinkage, "sig_sqrt", *module);
-    functions["sqrt"] = sqrt_func;
-
-    // max(a, b) - maximum of two numbers
-    std::vector<Type *> max_args = {Type::getDoubleTy(*context), Type::getDoubleTy(*context)};
-    FunctionType *max_type = FunctionType::get(Type::getDoubleTy(*context), max_args, false);
-    Function *max_func = Function::Create(max_type, Function::ExternalLinkage, "sig_max", *module);
-    functions["max"] = max_func;
-
-    // min(a, b) - minimum of two numbers
-    std::vector<Type *> min_args = {Type::getDoubleTy(*context), Type::getDoubleTy(*context)};
-    FunctionType *min_type = FunctionType::get(Type::getDoubleTy(*context), min_args, false);
-    Function *min_func = Function::Create(min_type, Function::ExternalLinkage, "sig_min", *module);
-    functions["min"] = min_func;
+    // abs, sqrt, max, min and the other math and bit builtins are lowered
+    // to intrinsics in codegen_builtin_call
+}
+
+// Replaces the builtin declarations with the runtime's own definitions,
+// read from the bitcode installed beside the runtime archive, so that the
+// optimizer can inline calls like sig_len into their callers. Only what the
+// program uses is linked, and it is internalized so the archive's copies
+// are never pulled in. Without the bitcode the calls simply stay external.
+void CodeGen::link_runtime_bitcode()
+{
+    if (no_std || runtime_linked)
+    {
+        return;
+    }
+    runtime_linked = true;
+
+    std::string path = find_runtime_file("sig_runtime.bc");
+    if (path.empty())
+    {
+        return;
+    }
+    auto buffer = MemoryBuffer::getFile(path);
+    if (!buffer)
+    {
+        std::cerr << "Warning: Could not read " << path << ": " << buffer.getError().message() << std::endl;
+        return;
+    }
+    auto runtime = parseBitcodeFile((*buffer)->getMemBufferRef(), *context);
+    if (!runtime)
+    {
+        std::cerr << "Warning: Could not load " << path << ": " << toString(runtime.takeError()) << std::endl;
+        return;
+    }
+
+    // The bitcode is built for the host; -m32 and cross builds use the archive
+    if (Triple((*runtime)->getTargetTriple()).getArch() != Triple(module->getTargetTriple()).getArch())
+    {
+        return;
+    }
+    (*runtime)->setTargetTriple(module->getTargetTriple());
+    (*runtime)->setDataLayout(module->getDataLayout());
+
+    // CPU attributes are the module's to choose; mismatched ones would also
+    // keep the inliner from merging the functions into their callers
+    std::vector<std::string> builtins;
+    for (Function &F : **runtime)
+    {
+        F.removeFnAttr("target-cpu");
+        F.removeFnAttr("target-features");
+        F.removeFnAttr("tune-cpu");
+        if (!F.isDeclaration())
+        {
+            builtins.push_back(F.getName().str());
+        }
+    }
+
+    bool failed = Linker::linkModules(*module, std::move(*runtime), Linker::Flags::LinkOnlyNeeded,
+                                      [](Module &linked, const StringSet<> &imported)
+                                      {
+                                          internalizeModule(linked, [&](const GlobalValue &value)
+                                                            { return !value.hasName() || !imported.count(value.getName()); });
+                                      });
+    if (failed)
+    {
+        std::cerr << "Warning: Could not link " << path << std::endl;
+        return;
+    }
+
+    // Every builtin is declared up front, so the unused ones were linked too
+    for (const std::string &builtin : builtins)
+    {
+        Function *F = module->getFunction(builtin);
+        if (F && F->hasLocalLinkage() && F->use_empty())
+        {
+            std::erase_if(functions, [F](const auto &entry)
+                          { return entry.second == F; });
+            F->eraseFromParent();
+        }
+    }
 }
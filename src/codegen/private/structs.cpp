@@ -0,0 +1,195 @@
+#include "../public/codegen.hpp"
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+using namespace llvm;
+
+// Fields are laid out by decreasing alignment, which leaves no padding
+// between them since every field's size is a multiple of its alignment;
+// equal alignments keep declaration order. A packed struct keeps
+// declaration order with no padding at all. align(N) raises the struct's
+// alignment to N and pads its size to a multiple of N, so every element of
+// an array of them starts on an N-byte boundary.
+void CodeGen::define_struct(const StructDefinition& s) {
+    const DataLayout& data_layout = module->getDataLayout();
+    auto fields = ast_arena->list(s.fields);
+    std::vector<unsigned> order(fields.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (!s.packed) {
+        std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+            return data_layout.getABITypeAlign(llvm_type(fields[a].type)) >
+                   data_layout.getABITypeAlign(llvm_type(fields[b].type));
+        });
+    }
+
+    RecordLayout layout;
+    layout.fields = s.fields;
+    layout.slots.resize(fields.size());
+    std::vector<Type*> members;
+    for (unsigned slot = 0; slot < order.size(); ++slot) {
+        members.push_back(llvm_type(fields[order[slot]].type));
+        layout.slots[order[slot]] = slot;
+    }
+
+    StructType* unpadded = StructType::get(*context, members, s.packed);
+    layout.align = std::max(data_layout.getABITypeAlign(unpadded), MaybeAlign(s.align).valueOrOne());
+    if (layout.align > data_layout.getABITypeAlign(unpadded)) {
+        uint64_t end = data_layout.getStructLayout(unpadded)->getElementOffset(members.size() - 1);
+        end += data_layout.getTypeAllocSize(members.back());
+        if (uint64_t padding = alignTo(end, layout.align) - end) {
+            members.push_back(llvm::ArrayType::get(builder->getInt8Ty(), padding));
+        }
+    }
+    layout.type = StructType::create(*context, members, "struct." + name(s.name), s.packed);
+    struct_layouts[s.name] = std::move(layout);
+}
+
+CodeGen::Variable CodeGen::declare_struct(Symbol var_name, Symbol record) {
+    const RecordLayout& layout = record_layout(record);
+    AllocaInst* slot = create_entry_alloca(layout.type, name(var_name));
+    slot->setAlignment(layout.align);
+    return variables.bind(var_name, Variable{slot, SigType::Struct, ArrayShape{SigType::I32, 0, record}});
+}
+
+// Address of a struct variable or element of an array of structs; a
+// literal is built in a temporary
+Value* CodeGen::struct_address(const Expression& value) {
+    const ExprNode& node = ast_arena->expression(std::get<ExprRef>(value));
+    if (node.kind == ExprKind::StructLiteral) {
+        const RecordLayout& layout = record_layout(node.name);
+        AllocaInst* temporary = create_entry_alloca(layout.type, name(node.name) + ".literal");
+        temporary->setAlignment(layout.align);
+        return store_struct(temporary, node.name, value) ? temporary : nullptr;
+    }
+    if (node.kind == ExprKind::Index) {
+        return element_pointer(node.name, node.left);
+    }
+    const Variable* var = variables.find(node.name);
+    if (!var || var->type != SigType::Struct) {
+        std::cerr << "Error: " << name(node.name) << " is not a struct" << std::endl;
+        return nullptr;
+    }
+    return var->slot;
+}
+
+// Stores a literal as one aggregate, with the fields it leaves out zero;
+// anything else is copied. Sema has matched the struct types.
+Value* CodeGen::store_struct(Value* destination, Symbol record, const Expression& value) {
+    const RecordLayout& layout = record_layout(record);
+    const ExprNode& node = ast_arena->expression(std::get<ExprRef>(value));
+    if (node.kind == ExprKind::StructLiteral) {
+        // Every field is evaluated before the store, so the literal may read
+        // the struct it replaces
+        auto fields = ast_arena->list(layout.fields);
+        auto names = ast_arena->list(node.fields);
+        auto values = ast_arena->list(node.elements);
+        Value* aggregate = Constant::getNullValue(layout.type);
+        for (size_t i = 0; i < values.size(); ++i) {
+            auto field = std::find_if(fields.begin(), fields.end(),
+                                      [&](const TypedName& candidate) { return candidate.name == names[i]; });
+            Value* converted = field != fields.end() ? codegen_typed(values[i], field->type) : nullptr;
+            if (!converted) {
+                return nullptr;
+            }
+            aggregate = builder->CreateInsertValue(aggregate, converted, layout.slots[field - fields.begin()]);
+        }
+        return builder->CreateAlignedStore(aggregate, destination, layout.align);
+    }
+
+    Value* source = struct_address(value);
+    if (!source) {
+        return nullptr;
+    }
+    if (source == destination) {
+        return destination;
+    }
+    // A struct parameter may point at the very struct it is copied from
+    uint64_t size = module->getDataLayout().getTypeAllocSize(layout.type);
+    return builder->CreateMemMove(destination, layout.align, source, layout.align, size);
+}
+
+// Field `field` of struct variable `target`, or of element `index` of the
+// array of structs `target`. Variables, parameters and array elements are
+// all aligned to the struct, so the field is aligned to the struct's
+// alignment at its offset.
+CodeGen::FieldAddress CodeGen::field_address(Symbol target, const Expression* index, Symbol field) {
+    const Variable* found = variables.find(target);
+    if (!found) {
+        std::cerr << "Error: Undefined variable " << name(target) << std::endl;
+        return {};
+    }
+    const RecordLayout& layout = record_layout(found->array.record);
+    Value* base = index ? element_pointer(target, *index) : found->slot;
+    if (!base) {
+        return {};
+    }
+
+    auto fields = ast_arena->list(layout.fields);
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (fields[i].name == field) {
+            unsigned slot = layout.slots[i];
+            uint64_t offset = module->getDataLayout().getStructLayout(layout.type)->getElementOffset(slot);
+            Value* pointer = builder->CreateStructGEP(layout.type, base, slot, name(field) + ".addr");
+            return FieldAddress{pointer, fields[i].type, commonAlignment(layout.align, offset)};
+        }
+    }
+    std::cerr << "Error: Struct " << name(found->array.record) << " has no field " << name(field) << std::endl;
+    return {};
+}
+
+// Field and ElementField nodes
+Value* CodeGen::codegen_field_access(const ExprNode& node) {
+    FieldAddress field = field_address(node.name, node.kind == ExprKind::ElementField ? &node.left : nullptr, node.field);
+    if (!field.pointer) {
+        return nullptr;
+    }
+    return builder->CreateAlignedLoad(llvm_type(field.type), field.pointer, field.align, name(node.field));
+}
+
+// let p: S; starts zeroed
+Value* CodeGen::codegen_struct_declaration(const VariableDeclaration& s) {
+    Variable var = declare_struct(s.var_name, s.array.record);
+    const RecordLayout& layout = record_layout(s.array.record);
+    uint64_t size = module->getDataLayout().getTypeAllocSize(layout.type);
+    return builder->CreateMemSet(var.slot, builder->getInt8(0), size, layout.align);
+}
+
+// A struct variable takes a literal or a copy of another struct; a new one
+// has the struct of its annotation or of the value
+Value* CodeGen::codegen_struct_assignment(const VariableAssignment& s) {
+    const ExprNode& value = ast_arena->expression(std::get<ExprRef>(s.value));
+    Variable var;
+    if (const Variable* found = variables.find(s.var_name)) {
+        var = *found;
+    } else if (s.type) {
+        var = declare_struct(s.var_name, s.array.record);
+    } else if (value.kind == ExprKind::StructLiteral) {
+        var = declare_struct(s.var_name, value.name);
+    } else if (const Variable* source = variables.find(value.name)) {
+        var = declare_struct(s.var_name, source->array.record);
+    } else {
+        std::cerr << "Error: Undefined variable " << name(value.name) << std::endl;
+        return nullptr;
+    }
+    return store_struct(var.slot, var.array.record, s.value);
+}
+
+Value* CodeGen::codegen_field_assignment(const FieldAssignment& s) {
+    FieldAddress field = field_address(s.target, s.index ? &*s.index : nullptr, s.field);
+    Value* value = field.pointer ? codegen_typed(s.value, field.type) : nullptr;
+    if (!value) {
+        return nullptr;
+    }
+    return builder->CreateAlignedStore(value, field.pointer, field.align);
+}
+
+// A struct parameter points at the caller's struct, which is whole and
+// aligned for the length of the call
+void CodeGen::add_struct_parameter(Function* func, unsigned index, Symbol record) {
+    const RecordLayout& layout = record_layout(record);
+    func->addParamAttr(index, Attribute::NonNull);
+    func->addParamAttr(index, Attribute::NoUndef);
+    func->addDereferenceableParamAttr(index, module->getDataLayout().getTypeAllocSize(layout.type));
+    func->addParamAttr(index, Attribute::getWithAlignment(*context, layout.align));
+}
@@ -0,0 +1,102 @@
+#include "../public/target_context.hpp"
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetOptions.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+#include <llvm/TargetParser/Triple.h>
+#include <llvm/ADT/StringMap.h>
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+TargetContext& TargetContext::instance() {
+    static TargetContext context;
+    return context;
+}
+
+const Target* TargetContext::lookup_target(const std::string& triple, std::string& error) {
+    // Registering every backend costs more than a small compile, so start
+    // with the one for this machine. The asm parser is needed for asm blocks.
+    std::call_once(native_once, [] {
+        InitializeNativeTarget();
+        InitializeNativeTargetAsmPrinter();
+        InitializeNativeTargetAsmParser();
+    });
+    if (const Target* target = TargetRegistry::lookupTarget(triple, error)) {
+        return target;
+    }
+
+    std::call_once(all_once, [] {
+        InitializeAllTargetInfos();
+        InitializeAllTargets();
+        InitializeAllTargetMCs();
+        InitializeAllAsmParsers();
+        InitializeAllAsmPrinters();
+    });
+    error.clear();
+    return TargetRegistry::lookupTarget(triple, error);
+}
+
+TargetMachine* TargetContext::target_machine(const TargetConfig& config, std::string& error) {
+    const Target* target = lookup_target(config.triple, error);
+    if (!target) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = machines.find(config);
+    if (found != machines.end()) {
+        return found->second.get();
+    }
+
+    std::unique_ptr<TargetMachine> machine;
+    if (config.jit) {
+        orc::JITTargetMachineBuilder builder{Triple(config.triple)};
+        builder.setCPU(config.cpu);
+        builder.addFeatures(SubtargetFeatures(config.features).getFeatures());
+        builder.setCodeGenOptLevel(config.opt_level);
+        auto created = builder.createTargetMachine();
+        if (!created) {
+            error = toString(created.takeError());
+            return nullptr;
+        }
+        machine = std::move(*created);
+    } else {
+        TargetOptions options;
+        auto RM = std::optional<Reloc::Model>();
+        machine.reset(target->createTargetMachine(config.triple, config.cpu, config.features, options, RM,
+                                                  std::nullopt, config.opt_level));
+    }
+
+    TargetMachine* result = machine.get();
+    machines.emplace(config, std::move(machine));
+    return result;
+}
+
+const std::string& TargetContext::host_cpu() {
+    host_features();
+    return cpu_name;
+}
+
+const std::string& TargetContext::host_features() {
+    std::call_once(host_once, [this] {
+        cpu_name = sys::getHostCPUName().str();
+
+        // Sorted so the same host always yields the same feature string
+        StringMap<bool> host_features = sys::getHostCPUFeatures();
+        std::vector<std::pair<StringRef, bool>> sorted;
+        for (const auto& feature : host_features) {
+            sorted.emplace_back(feature.first(), feature.second);
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        SubtargetFeatures feature_list;
+        for (const auto& [name, enabled] : sorted) {
+            feature_list.AddFeature(name, enabled);
+        }
+        cpu_features = feature_list.getString();
+    });
+    return cpu_features;
+}
@@ -0,0 +1,329 @@
+#include "../public/tiered_jit.hpp"
+#include "../public/codegen.hpp"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <iomanip>
+#include <iostream>
+
+using namespace llvm;
+
+// Tier 0 code reports hot functions through a plain function pointer, so
+// the instance currently running is reachable from a static
+static TieredJIT* active_tiering = nullptr;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+TieredJIT::TieredJIT(std::unique_ptr<LLVMContext> context, std::unique_ptr<Module> module,
+                     TargetConfig config, uint64_t threshold)
+    : context(std::move(context)), module(std::move(module)), config(std::move(config)), threshold(threshold) {}
+
+TieredJIT::~TieredJIT() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        requests.clear();
+    }
+    work_available.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (active_tiering == this) {
+        active_tiering = nullptr;
+    }
+}
+
+void TieredJIT::tier_up(uint32_t id) {
+    TieredJIT* self = active_tiering;
+    if (!self) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        if (self->stopping) {
+            return;
+        }
+        self->requests.push_back(id);
+    }
+    self->work_available.notify_one();
+}
+
+// Splits a tier 1 copy off the module, then turns every function but main
+// into "<name>.tier0" with an entry counter, leaving "<name>" to the stub
+bool TieredJIT::instrument() {
+    // Both tiers link against the same globals, so local ones get names
+    // that the tier 1 copy will refer to
+    for (GlobalVariable& var : module->globals()) {
+        if (var.hasLocalLinkage()) {
+            var.setLinkage(GlobalValue::ExternalLinkage);
+        }
+        if (!var.hasName()) {
+            var.setName("sig.global");
+        }
+    }
+
+    // The copy lives in a context of its own so the worker can optimize it
+    // while tier 0 code runs
+    SmallVector<char, 0> buffer;
+    raw_svector_ostream stream(buffer);
+    WriteBitcodeToFile(*module, stream);
+    tier1_context = std::make_unique<LLVMContext>();
+    auto copy = parseBitcodeFile(MemoryBufferRef(StringRef(buffer.data(), buffer.size()), "tier1"), *tier1_context);
+    if (!copy) {
+        std::cerr << "Failed to copy module for tier 1: " << toString(copy.takeError()) << std::endl;
+        return false;
+    }
+    tier1_module = std::move(*copy);
+
+    for (auto& part : CodeGen::split_by_function(*tier1_module)) {
+        for (Function& F : *part) {
+            if (!F.isDeclaration()) {
+                Tiered tiered;
+                tiered.name = F.getName().str();
+                tiered.stats.name = tiered.name;
+                F.setName(tiered.name + ".tier1");
+                tiered.tier1 = std::move(part);
+                functions.push_back(std::move(tiered));
+                break;
+            }
+        }
+    }
+
+    LLVMContext& ctx = module->getContext();
+    Type* counter_type = Type::getInt64Ty(ctx);
+    FunctionCallee report = module->getOrInsertFunction(
+        "sig_tier_up", FunctionType::get(Type::getVoidTy(ctx), {Type::getInt32Ty(ctx)}, false));
+
+    for (uint32_t id = 0; id < functions.size(); ++id) {
+        const std::string& name = functions[id].name;
+        Function* body = module->getFunction(name);
+
+        Function* stub = Function::Create(body->getFunctionType(), GlobalValue::ExternalLinkage, "", *module);
+        stub->setCallingConv(body->getCallingConv());
+        stub->setAttributes(body->getAttributes());
+        body->replaceAllUsesWith(stub);
+        stub->takeName(body);
+        body->setName(name + ".tier0");
+        if (body->hasLocalLinkage()) {
+            body->setLinkage(GlobalValue::ExternalLinkage);
+        }
+
+        // A plain, unsynchronized count: losing an increment to a race only
+        // delays the promotion
+        auto* counter = new GlobalVariable(*module, counter_type, false, GlobalValue::ExternalLinkage,
+                                           ConstantInt::get(counter_type, 0), name + ".calls");
+        Instruction* first = &*body->getEntryBlock().getFirstInsertionPt();
+        IRBuilder<> entry(first);
+        Value* count = entry.CreateAdd(entry.CreateLoad(counter_type, counter), ConstantInt::get(counter_type, 1));
+        entry.CreateStore(count, counter);
+        Value* hot = entry.CreateICmpEQ(count, ConstantInt::get(counter_type, threshold));
+        IRBuilder<> promote(SplitBlockAndInsertIfThen(hot, first, false));
+        promote.CreateCall(report, {promote.getInt32(id)});
+    }
+    return true;
+}
+
+bool TieredJIT::run(int& result) {
+    start = std::chrono::steady_clock::now();
+
+    TargetConfig tier0_config = config;
+    tier0_config.opt_level = CodeGenOptLevel::None;
+    std::string error;
+    TargetMachine* machine = TargetContext::instance().target_machine(tier0_config, error);
+    if (!machine) {
+        std::cerr << "Failed to create target machine: " << error << std::endl;
+        return false;
+    }
+    module->setDataLayout(machine->createDataLayout());
+    if (!instrument()) {
+        return false;
+    }
+
+    orc::JITTargetMachineBuilder builder(machine->getTargetTriple());
+    builder.setCPU(tier0_config.cpu);
+    builder.addFeatures(SubtargetFeatures(tier0_config.features).getFeatures());
+    builder.setCodeGenOptLevel(tier0_config.opt_level);
+    auto created = orc::LLJITBuilder()
+        .setJITTargetMachineBuilder(std::move(builder))
+        .setDataLayout(machine->createDataLayout())
+        .setCompileFunctionCreator([machine](orc::JITTargetMachineBuilder)
+                                       -> Expected<std::unique_ptr<orc::IRCompileLayer::IRCompiler>> {
+            return std::make_unique<orc::SimpleCompiler>(*machine);
+        })
+        .create();
+    if (!created) {
+        std::cerr << "Failed to create JIT: " << toString(created.takeError()) << std::endl;
+        return false;
+    }
+    jit = std::move(*created);
+    orc::JITDylib& main_dylib = jit->getMainJITDylib();
+
+    auto process_symbols = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        jit->getDataLayout().getGlobalPrefix());
+    if (!process_symbols) {
+        std::cerr << "Failed to create process symbols generator: " << toString(process_symbols.takeError())
+                  << std::endl;
+        return false;
+    }
+    main_dylib.addGenerator(std::move(*process_symbols));
+
+    // Callers always go through "<name>", an indirect stub whose pointer is
+    // set to tier 0 below and swapped to tier 1 on promotion
+    stubs = orc::createLocalIndirectStubsManagerBuilder(machine->getTargetTriple())();
+    orc::SymbolMap symbols = CodeGen::runtime_symbols(*jit);
+    for (const Tiered& tiered : functions) {
+        if (auto err = stubs->createStub(tiered.name, orc::ExecutorAddr(),
+                                         JITSymbolFlags::Exported | JITSymbolFlags::Callable)) {
+            std::cerr << "Failed to create stub for " << tiered.name << ": " << toString(std::move(err)) << std::endl;
+            return false;
+        }
+        symbols[jit->mangleAndIntern(tiered.name)] = stubs->findStub(tiered.name, true);
+    }
+    symbols[jit->mangleAndIntern("sig_tier_up")] = orc::ExecutorSymbolDef(
+        orc::ExecutorAddr::fromPtr(&TieredJIT::tier_up), JITSymbolFlags::Exported | JITSymbolFlags::Callable);
+    if (auto err = main_dylib.define(orc::absoluteSymbols(std::move(symbols)))) {
+        std::cerr << "Failed to define stubs: " << toString(std::move(err)) << std::endl;
+        return false;
+    }
+
+    if (auto err = jit->addIRModule(orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+        std::cerr << "Failed to add module: " << toString(std::move(err)) << std::endl;
+        return false;
+    }
+    for (Tiered& tiered : functions) {
+        auto body = jit->lookup(tiered.name + ".tier0");
+        if (!body) {
+            std::cerr << "Failed to compile " << tiered.name << ": " << toString(body.takeError()) << std::endl;
+            return false;
+        }
+        if (auto err = stubs->updatePointer(tiered.name, *body)) {
+            std::cerr << "Failed to set stub for " << tiered.name << ": " << toString(std::move(err)) << std::endl;
+            return false;
+        }
+        auto counter = jit->lookup(tiered.name + ".calls");
+        if (!counter) {
+            std::cerr << "Failed to find counter for " << tiered.name << ": " << toString(counter.takeError())
+                      << std::endl;
+            return false;
+        }
+        tiered.counter = counter->toPtr<uint64_t*>();
+    }
+
+    auto main_symbol = jit->lookup("main");
+    if (!main_symbol) {
+        std::cerr << "Failed to find main function: " << toString(main_symbol.takeError()) << std::endl;
+        return false;
+    }
+
+    active_tiering = this;
+    worker = std::thread(&TieredJIT::work, this);
+    auto main_function = (int (*)())main_symbol->getValue();
+    result = main_function();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        requests.clear();
+    }
+    work_available.notify_all();
+    worker.join();
+    active_tiering = nullptr;
+    return true;
+}
+
+void TieredJIT::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_available.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (stopping) {
+            return;
+        }
+        uint32_t id = requests.front();
+        requests.pop_front();
+        lock.unlock();
+        promote(id);
+        lock.lock();
+    }
+}
+
+// Runs on the worker thread, which alone uses tier1_context and the -O3
+// machine
+void TieredJIT::promote(uint32_t id) {
+    Tiered& tiered = functions[id];
+    auto begin = std::chrono::steady_clock::now();
+
+    TargetConfig tier1_config = config;
+    tier1_config.opt_level = CodeGenOptLevel::Aggressive;
+    std::string error;
+    TargetMachine* machine = TargetContext::instance().target_machine(tier1_config, error);
+    if (!machine) {
+        std::cerr << "Tier 1 of " << tiered.name << " failed: " << error << std::endl;
+        return;
+    }
+
+    CodeGen::optimize(*tiered.tier1, *machine, 3, false);
+    orc::SimpleCompiler compile(*machine);
+    auto object = compile(*tiered.tier1);
+    tiered.tier1.reset();
+    if (!object) {
+        std::cerr << "Tier 1 of " << tiered.name << " failed: " << toString(object.takeError()) << std::endl;
+        return;
+    }
+    if (auto err = jit->addObjectFile(std::move(*object))) {
+        std::cerr << "Tier 1 of " << tiered.name << " failed: " << toString(std::move(err)) << std::endl;
+        return;
+    }
+    auto body = jit->lookup(tiered.name + ".tier1");
+    if (!body) {
+        std::cerr << "Tier 1 of " << tiered.name << " failed: " << toString(body.takeError()) << std::endl;
+        return;
+    }
+    double compile_ms = elapsed_ms(begin);
+    if (auto err = stubs->updatePointer(tiered.name, *body)) {
+        std::cerr << "Tier 1 of " << tiered.name << " failed: " << toString(std::move(err)) << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    tiered.stats.promoted = true;
+    tiered.stats.compile_ms = compile_ms;
+    tiered.stats.promoted_after_ms = elapsed_ms(start);
+}
+
+std::vector<TieredJIT::FunctionStats> TieredJIT::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<FunctionStats> result;
+    for (const Tiered& tiered : functions) {
+        FunctionStats stats = tiered.stats;
+        if (tiered.counter) {
+            stats.tier0_calls = *tiered.counter;
+        }
+        result.push_back(stats);
+    }
+    return result;
+}
+
+void TieredJIT::dump_stats(std::ostream& out) const {
+    std::vector<FunctionStats> all = stats();
+    size_t promoted = 0;
+    for (const FunctionStats& stats : all) {
+        promoted += stats.promoted;
+    }
+    out << "Tiered JIT: " << all.size() << " function(s), " << promoted << " promoted to tier 1 at "
+        << threshold << " call(s)\n";
+    out << std::fixed << std::setprecision(2);
+    for (const FunctionStats& stats : all) {
+        out << "  " << stats.name << ": " << stats.tier0_calls << " tier 0 call(s)";
+        if (stats.promoted) {
+            out << ", tier 1 after " << stats.promoted_after_ms << " ms (compiled in " << stats.compile_ms << " ms)";
+        }
+        out << "\n";
+    }
+}
@@ -14,9 +14,14 @@
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Target/TargetMachine.h>
 #include <memory>
+#include <optional>
 #include <unordered_map>
+#include <vector>
 #include <string>
 #include <ast/public/ast_simple.hpp>
+#include <ast/public/scoped_table.hpp>
+
+class JitObjectCache;
 
 class CodeGen {
 private:
@@ -25,27 +30,151 @@ private:
     std::unique_ptr<llvm::IRBuilder<>> builder;
     std::unique_ptr<llvm::orc::LLJIT> jit;
     
-    // Symbol tables
-    std::unordered_map<std::string, llvm::Value*> variables;
+    // Symbol tables; variables are scoped by block and function
+    struct Variable {
+        // An alloca, or for a struct parameter the caller's struct
+        llvm::Value* slot = nullptr;
+        SigType type = SigType::I32;
+        ArrayShape array{};  // Array, Slice and Struct
+    };
+    ScopedTable<Variable> variables;
+    
+    // Each struct's LLVM type, the slot of each field (in declaration
+    // order) within it, and the alignment of the whole (see define_struct)
+    struct RecordLayout {
+        llvm::StructType* type = nullptr;
+        std::vector<unsigned> slots;
+        Range<TypedName> fields;
+        llvm::Align align;
+    };
+    std::unordered_map<Symbol, RecordLayout, SymbolHash> struct_layouts;
+    
+    // A field's address, type and the alignment accesses to it may assume
+    struct FieldAddress {
+        llvm::Value* pointer = nullptr;
+        SigType type = SigType::I32;
+        llvm::Align align;
+    };
+    
+    // Accesses array[counter + offset] that the enclosing loop's range
+    // guard has proven in bounds, so they skip their checks (see codegen_for)
+    struct RangeProof {
+        Symbol array;
+        Symbol counter;
+        int64_t offset;
+    };
+    std::vector<RangeProof> proven_accesses;
     std::unordered_map<std::string, llvm::Function*> functions;
     
+    // String literals by content, each emitted once (see string_constant)
+    std::unordered_map<std::string, llvm::Constant*> string_constants;
+    
+    // Arena holding the program being compiled
+    const AstArena* ast_arena = nullptr;
+    
     // Current function being compiled
     llvm::Function* current_function = nullptr;
     
+    // Set when a statement could not be compiled; compile() stops instead
+    // of handing on a partial module
+    bool codegen_failed = false;
+    
     // Target architecture
     bool target_32bit = false;
     
     // Standard library configuration
     bool no_std = false;
+    bool runtime_linked = false;
+    
+    // Optimization level (-O0..-O3, -Os)
+    unsigned opt_level = 0;
+    bool optimize_size = false;
+    
+    // CPU and feature string for code generation; an empty CPU means
+    // "generic" for AOT output and the host CPU for the JIT
+    std::string target_cpu;
+    std::string target_features;
+    
+    // --jit-lazy compiles each function on its first call, optionally
+    // on a pool of jit_threads background compile threads
+    bool lazy_jit = false;
+    unsigned jit_threads = 0;
+    
+    // --jit-tiered starts every function at -O0 and recompiles the ones
+    // called tier_threshold times at -O3 (see TieredJIT); 0 picks the
+    // default threshold
+    bool tiered_jit = false;
+    uint64_t tier_threshold = 0;
+    bool jit_stats = false;
+    
+    // Compiled JIT objects are reused across runs when set (not owned)
+    JitObjectCache* object_cache = nullptr;
     
     // Helper methods
-    llvm::Value* codegen_stmt(const ASTNode& stmt);
+    llvm::Value* codegen_stmt(NodeRef stmt);
+    void codegen_block(Range<NodeRef> block);
+    llvm::Value* codegen_if(const IfStatement& s);
+    llvm::Value* codegen_while(const WhileStatement& s);
+    llvm::Value* codegen_for(const ForStatement& s);
+    void codegen_for_loop(const ForStatement& s, llvm::Value* start, llvm::Value* end, SigType counter_sig,
+                          bool counter_rebound);
+    llvm::Value* codegen_condition(const Expression& condition);
+    void add_loop_hints(llvm::BranchInst* latch, llvm::BasicBlock* header, bool finite);
+    llvm::AllocaInst* create_entry_alloca(llvm::Type* type, const std::string& var_name);
+    llvm::Type* llvm_type(SigType type);
+    llvm::Value* convert_value(llvm::Value* value, SigType from, SigType to);
+    llvm::Value* codegen_operator(SigBinaryOperator op, llvm::Value* lhs, llvm::Value* rhs, SigType operand_type);
+    llvm::Value* codegen_expr_node(const ExprNode& node);
+    llvm::Value* codegen_typed(const Expression& expr, SigType type);
     llvm::Value* codegen_binary_expr(const BinaryExpression& expr);
+    llvm::Value* codegen_short_circuit(SigBinaryOperator op, const Expression& left, const Expression& right);
     llvm::Value* codegen_unary_expr(const UnaryExpression& expr);
-    llvm::Value* codegen_value(const std::variant<int, double, bool, std::string, TypedValue>& value);
+    llvm::StructType* slice_type();
+    llvm::Type* storage_type(SigType type, const ArrayShape& array);
+    llvm::Type* element_type(const ArrayShape& array);
+    Variable declare_array(Symbol var_name, SigType type, const ArrayShape& array);
+    llvm::Value* array_data(const Variable& var);
+    llvm::Value* array_length(const Variable& var);
+    void codegen_bounds_check(llvm::Value* in_range, llvm::Value* index, llvm::Value* length);
+    llvm::Value* element_pointer(Symbol array, const Expression& index);
+    llvm::Value* codegen_array_access(const ExprNode& node);
+    llvm::Value* codegen_array_declaration(const VariableDeclaration& s);
+    llvm::Value* codegen_array_assignment(const VariableAssignment& s);
+    llvm::Value* codegen_index_assignment(const IndexAssignment& s);
+    llvm::Value* codegen_range_guard(const ForStatement& s, llvm::Value* start, llvm::Value* end,
+                                     std::vector<RangeProof>& proofs);
+    bool rebinds_counter(const ForStatement& s) const;
+    void define_struct(const StructDefinition& s);
+    const RecordLayout& record_layout(Symbol record) const { return struct_layouts.at(record); }
+    Variable declare_struct(Symbol var_name, Symbol record);
+    llvm::Value* struct_address(const Expression& value);
+    llvm::Value* store_struct(llvm::Value* destination, Symbol record, const Expression& value);
+    FieldAddress field_address(Symbol target, const Expression* index, Symbol field);
+    llvm::Value* codegen_field_access(const ExprNode& node);
+    llvm::Value* codegen_struct_declaration(const VariableDeclaration& s);
+    llvm::Value* codegen_struct_assignment(const VariableAssignment& s);
+    llvm::Value* codegen_field_assignment(const FieldAssignment& s);
+    void add_struct_parameter(llvm::Function* func, unsigned index, Symbol record);
+    llvm::Constant* string_constant(const std::string& text);
+    llvm::Value* codegen_write(llvm::Value* val, SigType sig_type);
     llvm::Value* codegen_expression(const Expression& expr);
+    const std::string& name(Symbol symbol) const { return ast_arena->symbols.name(symbol); }
     void setup_runtime_functions();
+    llvm::Function* runtime_function(const char* function_name);
+    bool codegen_builtin_call(const std::string& function_name, std::vector<llvm::Value*>& args,
+                              const std::vector<SigType>& arg_types,
+                              llvm::Value*& result);
+    llvm::Value* codegen_call(const ExprNode& node);
+    llvm::Value* string_length(llvm::Value* text);
+    void link_runtime_bitcode();
+    static std::string find_runtime_file(const char* name);
     void configure_target_architecture();
+    llvm::TargetMachine* create_target_machine();
+    llvm::CodeGenOptLevel codegen_opt_level() const;
+    void optimize_module(llvm::Module& target_module, llvm::TargetMachine& target_machine);
+    void annotate_for_target(llvm::TargetMachine& target_machine);
+    void prepare_for_target(llvm::TargetMachine& target_machine);
+    bool link_executable(const std::string& object_file, const std::string& output_name);
     
 public:
     CodeGen();
@@ -55,9 +184,24 @@ public:
     
     // Configuration
     void set_target_32bit(bool enable) { target_32bit = enable; }
+    void set_optimization_level(unsigned level, bool size) {
+        opt_level = level;
+        optimize_size = size;
+    }
+    void set_target_cpu(const std::string& cpu, const std::string& features);
+    void set_lazy_jit(bool enable, unsigned threads) {
+        lazy_jit = enable;
+        jit_threads = threads;
+    }
+    void set_tiered_jit(uint64_t threshold, bool stats) {
+        tiered_jit = true;
+        tier_threshold = threshold;
+        jit_stats = stats;
+    }
+    void set_object_cache(JitObjectCache* cache) { object_cache = cache; }
     
     // Main compilation interface
-    void compile(const AST& program);
+    void compile(const AstArena& arena, const AST& program);
     void execute();
     void dump_ir();
     
@@ -69,4 +213,14 @@ public:
     
     // Alternative: compile to object file
     void compile_to_object(const std::string& filename);
+    
+    // Definitions for the runtime entry points JIT-compiled code calls
+    static llvm::orc::SymbolMap runtime_symbols(llvm::orc::LLJIT& target_jit);
+    
+    // Runs the default pipeline for -O<opt_level> (or -Os) over `target_module`
+    static void optimize(llvm::Module& target_module, llvm::TargetMachine& target_machine,
+                         unsigned opt_level, bool optimize_size);
+    
+    // Moves every function but main out of `source` into a module of its own
+    static std::vector<std::unique_ptr<llvm::Module>> split_by_function(llvm::Module& source);
 };
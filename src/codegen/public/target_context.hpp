@@ -0,0 +1,57 @@
+#pragma once
+
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+// Everything that determines how a TargetMachine generates code
+struct TargetConfig {
+    std::string triple;
+    std::string cpu;
+    std::string features;
+    llvm::CodeGenOptLevel opt_level = llvm::CodeGenOptLevel::None;
+    bool jit = false;  // JIT machines use ORC's target options
+
+    auto key() const { return std::tie(triple, cpu, features, opt_level, jit); }
+    bool operator<(const TargetConfig& other) const { return key() < other.key(); }
+};
+
+// Process-wide LLVM target state, created on first use. Only the native
+// backend is registered unless a module asks for another triple, and each
+// distinct TargetConfig gets one TargetMachine that every CodeGen in the
+// process reuses. A TargetMachine is not safe to drive from two threads at
+// once, so callers emitting concurrently must use distinct configs.
+class TargetContext {
+private:
+    std::mutex mutex;
+    std::once_flag native_once;
+    std::once_flag all_once;
+    std::once_flag host_once;
+    std::string cpu_name;
+    std::string cpu_features;
+    std::map<TargetConfig, std::unique_ptr<llvm::TargetMachine>> machines;
+
+    TargetContext() = default;
+
+public:
+    TargetContext(const TargetContext&) = delete;
+    TargetContext& operator=(const TargetContext&) = delete;
+
+    static TargetContext& instance();
+
+    // Registers the backend for `triple` if needed; null and `error` set if
+    // LLVM was built without it
+    const llvm::Target* lookup_target(const std::string& triple, std::string& error);
+
+    // Cached machine for `config`, or null with `error` set
+    llvm::TargetMachine* target_machine(const TargetConfig& config, std::string& error);
+
+    // Host CPU name and its full, sorted +/- feature string
+    const std::string& host_cpu();
+    const std::string& host_features();
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <codegen/public/target_context.hpp>
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Two-tier execution. Every function first runs from a quick -O0 build
+// whose entry block counts calls; when a function reaches `threshold`
+// calls it is recompiled at -O3 on a background thread and the indirect
+// stub its callers go through is repointed at the new code. main runs
+// once, so it stays at tier 0.
+class TieredJIT {
+public:
+    static constexpr uint64_t default_threshold = 1000;
+
+    struct FunctionStats {
+        std::string name;
+        uint64_t tier0_calls = 0;    // calls counted before the swap
+        bool promoted = false;
+        double compile_ms = 0;       // tier 1 optimization and codegen
+        double promoted_after_ms = 0;  // from program start to the swap
+    };
+
+    // `config` describes the host target; its opt level is ignored
+    TieredJIT(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module,
+              TargetConfig config, uint64_t threshold = default_threshold);
+    ~TieredJIT();
+
+    TieredJIT(const TieredJIT&) = delete;
+    TieredJIT& operator=(const TieredJIT&) = delete;
+
+    // Compiles tier 0, runs main and returns its result. Promotions still
+    // queued when main returns are dropped. False if anything failed to
+    // compile or link; the error has been printed.
+    bool run(int& result);
+
+    std::vector<FunctionStats> stats() const;
+    void dump_stats(std::ostream& out) const;
+
+private:
+    struct Tiered {
+        std::string name;
+        std::unique_ptr<llvm::Module> tier1;  // in tier1_context, consumed on promotion
+        uint64_t* counter = nullptr;          // tier 0 entry counter in JIT memory
+        FunctionStats stats;
+    };
+
+    std::unique_ptr<llvm::LLVMContext> context;
+    std::unique_ptr<llvm::Module> module;
+    std::unique_ptr<llvm::LLVMContext> tier1_context;
+    std::unique_ptr<llvm::Module> tier1_module;
+    TargetConfig config;
+    uint64_t threshold;
+
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    std::unique_ptr<llvm::orc::IndirectStubsManager> stubs;
+    std::vector<Tiered> functions;
+
+    mutable std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<uint32_t> requests;
+    bool stopping = false;
+    std::thread worker;
+    std::chrono::steady_clock::time_point start;
+
+    bool instrument();
+    void promote(uint32_t id);
+    void work();
+
+    static void tier_up(uint32_t id);
+};
@@ -0,0 +1,114 @@
+#include "../public/work_stealing_pool.hpp"
+
+// Index of the pool worker running on this thread, or SIZE_MAX elsewhere
+static thread_local size_t current_worker = SIZE_MAX;
+static thread_local const WorkStealingPool* current_pool = nullptr;
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    size_t target;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        ++queued;
+        ++unfinished;
+        // Tasks spawned by a worker stay local until somebody steals them
+        if (current_pool == this) {
+            target = current_worker;
+        } else {
+            target = next_queue;
+            next_queue = (next_queue + 1) % queues.size();
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    work_available.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    all_done.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool WorkStealingPool::pop_task(size_t worker, std::function<void()>& task) {
+    // Newest local task first: its inputs are most likely still in cache
+    {
+        WorkerQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    
+    // Otherwise steal the oldest task of another worker
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkerQueue& victim = *queues[(worker + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void WorkStealingPool::worker_loop(size_t worker) {
+    current_worker = worker;
+    current_pool = this;
+    
+    while (true) {
+        std::function<void()> task;
+        if (pop_task(worker, task)) {
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                --queued;
+            }
+            
+            task();
+            
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (--unfinished == 0) {
+                all_done.notify_all();
+            }
+            continue;
+        }
+        
+        // `queued` is raised before a task is pushed, so a worker that sees it
+        // non-zero retries instead of sleeping through the push
+        std::unique_lock<std::mutex> lock(state_mutex);
+        work_available.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
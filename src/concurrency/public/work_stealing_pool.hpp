@@ -0,0 +1,53 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool where every worker owns a task deque. Workers push
+// and pop their own tasks LIFO and, when they run dry, steal the oldest task
+// from another worker, so recursively spawned work (one task per discovered
+// module) spreads across cores without a single contended queue.
+class WorkStealingPool {
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    size_t queued = 0;      // tasks sitting in a deque
+    size_t unfinished = 0;  // tasks submitted but not yet completed
+    size_t next_queue = 0;  // round-robin target for submissions from outside the pool
+    bool stopping = false;
+
+    bool pop_task(size_t worker, std::function<void()>& task);
+    void worker_loop(size_t worker);
+
+public:
+    // Defaults to one worker per hardware thread
+    explicit WorkStealingPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // May be called from inside a running task
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task, including tasks those tasks
+    // submitted, has finished. Must not be called from a worker.
+    void wait();
+
+    size_t size() const { return threads.size(); }
+};
@@ -0,0 +1,157 @@
+#include "../public/incremental_document.hpp"
+#include <lexer/public/lexer.hpp>
+#include <parser/public/parser.hpp>
+#include <algorithm>
+
+// Replace dst[pos, pos + old_count) with the contents of src, moving as few
+// trailing elements as possible
+template <typename T>
+static void splice(std::vector<T>& dst, size_t pos, size_t old_count, std::vector<T>&& src) {
+    size_t common = std::min(old_count, src.size());
+    std::move(src.begin(), src.begin() + common, dst.begin() + pos);
+    
+    if (src.size() > old_count) {
+        dst.insert(dst.begin() + pos + common,
+                   std::make_move_iterator(src.begin() + common),
+                   std::make_move_iterator(src.end()));
+    } else if (old_count > src.size()) {
+        dst.erase(dst.begin() + pos + common, dst.begin() + pos + old_count);
+    }
+}
+
+IncrementalDocument::IncrementalDocument(std::string text, std::string file_path)
+    : file_path(std::move(file_path)), source(std::move(text)) {
+    reparse_all();
+}
+
+size_t IncrementalDocument::statement_at(size_t offset) const {
+    // Statement i owns [offset_i, offset_{i+1}); leading whitespace belongs to the first
+    auto it = std::upper_bound(statements.begin(), statements.end(), offset,
+        [](size_t value, const Statement& stmt) { return value < stmt.offset; });
+    return it == statements.begin() ? 0 : static_cast<size_t>(it - statements.begin()) - 1;
+}
+
+bool IncrementalDocument::apply_edit(const TextEdit& edit) {
+    if (edit.offset > source.size() || edit.removed_length > source.size() - edit.offset) {
+        error = "Edit range [" + std::to_string(edit.offset) + ", " +
+                std::to_string(edit.offset + edit.removed_length) + ") is outside the document";
+        return false;
+    }
+    
+    if (error || statements.empty()) {
+        source.replace(edit.offset, edit.removed_length, edit.inserted_text);
+        return reparse_all();
+    }
+    
+    size_t edit_end = edit.offset + edit.removed_length;
+    size_t first = statement_at(edit.offset);
+    size_t last = statement_at(edit_end);
+    
+    // An edit right at a statement boundary can glue onto the previous token
+    if (first > 0 && edit.offset == statements[first].offset) {
+        --first;
+    }
+    
+    ptrdiff_t delta = static_cast<ptrdiff_t>(edit.inserted_text.size()) - static_cast<ptrdiff_t>(edit.removed_length);
+    source.replace(edit.offset, edit.removed_length, edit.inserted_text);
+    
+    // Resynchronize: grow the damaged region forward one statement at a time
+    // (an unclosed brace or string swallows what follows), then fall back to
+    // the whole file for edits that change how earlier statements end
+    while (true) {
+        if (reparse_region(first, last, delta)) {
+            if (arena.node_count() > 2 * full_parse_nodes + 1024) {
+                return reparse_all();
+            }
+            return true;
+        }
+        if (last + 1 < statements.size()) {
+            ++last;
+        } else if (first > 0) {
+            first = 0;
+        } else {
+            break;
+        }
+    }
+    
+    statements.clear();
+    nodes.clear();
+    return false;
+}
+
+bool IncrementalDocument::reparse_region(size_t first, size_t last, ptrdiff_t delta) {
+    size_t region_begin = first == 0 ? 0 : statements[first].offset;
+    size_t region_end = last + 1 < statements.size()
+        ? static_cast<size_t>(static_cast<ptrdiff_t>(statements[last + 1].offset) + delta)
+        : source.size();
+    
+    StringInterner strings;
+    std::vector<StatementSpan> spans;
+    AST region_nodes;
+    
+    try {
+        auto tokens = tokenize(std::string_view(source).substr(region_begin, region_end - region_begin), strings, true);
+        region_nodes = parse_top_level(tokens, arena, file_path, spans);
+    } catch (const LexError& e) {
+        error = std::string("Lexer error: ") + e.what();
+        return false;
+    } catch (const ParseError& e) {
+        error = std::string("Parse error: ") + e.what();
+        return false;
+    }
+    
+    size_t first_node = statements[first].first_node;
+    size_t old_node_count = statements[last].first_node + statements[last].node_count - first_node;
+    ptrdiff_t node_delta = static_cast<ptrdiff_t>(region_nodes.size()) - static_cast<ptrdiff_t>(old_node_count);
+    
+    std::vector<Statement> region_statements;
+    region_statements.reserve(spans.size());
+    size_t node_index = first_node;
+    for (const auto& span : spans) {
+        region_statements.push_back(Statement{region_begin + span.offset, node_index, span.node_count});
+        node_index += span.node_count;
+    }
+    size_t new_statement_count = region_statements.size();
+    
+    splice(nodes, first_node, old_node_count, std::move(region_nodes));
+    splice(statements, first, last - first + 1, std::move(region_statements));
+    
+    // Everything after the region only moves
+    for (size_t i = first + new_statement_count; i < statements.size(); ++i) {
+        statements[i].offset = static_cast<size_t>(static_cast<ptrdiff_t>(statements[i].offset) + delta);
+        statements[i].first_node = static_cast<size_t>(static_cast<ptrdiff_t>(statements[i].first_node) + node_delta);
+    }
+    
+    error.reset();
+    return true;
+}
+
+bool IncrementalDocument::reparse_all() {
+    statements.clear();
+    nodes.clear();
+    arena = AstArena();
+    
+    StringInterner strings;
+    std::vector<StatementSpan> spans;
+    
+    try {
+        auto tokens = tokenize(source, strings, true);
+        nodes = parse_top_level(tokens, arena, file_path, spans);
+    } catch (const LexError& e) {
+        error = std::string("Lexer error: ") + e.what();
+        return false;
+    } catch (const ParseError& e) {
+        error = std::string("Parse error: ") + e.what();
+        return false;
+    }
+    
+    size_t node_index = 0;
+    for (const auto& span : spans) {
+        statements.push_back(Statement{span.offset, node_index, span.node_count});
+        node_index += span.node_count;
+    }
+    full_parse_nodes = arena.node_count();
+    
+    error.reset();
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <ast/public/ast_simple.hpp>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A single text change: `removed_length` bytes at `offset` are replaced by
+// `inserted_text`
+struct TextEdit {
+    size_t offset;
+    size_t removed_length;
+    std::string inserted_text;
+};
+
+// Keeps a source file, its top-level statement boundaries and its AST in sync
+// across edits for editor and watch-mode workflows. Only the statements an
+// edit touches are re-lexed and re-parsed; the damaged region grows one
+// statement at a time until it parses cleanly and the resulting nodes are
+// spliced into the AST in place. Replaced nodes stay in the arena until it
+// outgrows the last full parse, at which point the file is parsed afresh.
+class IncrementalDocument {
+private:
+    struct Statement {
+        size_t offset;      // byte offset of the statement's first token
+        size_t first_node;  // index of its first node in `nodes`
+        size_t node_count;
+    };
+
+    std::string file_path;
+    std::string source;
+    std::vector<Statement> statements;
+    AstArena arena;
+    AST nodes;
+    size_t full_parse_nodes = 0;  // arena size right after the last full parse
+    std::optional<std::string> error;
+
+    size_t statement_at(size_t offset) const;
+    bool reparse_region(size_t first, size_t last, ptrdiff_t delta);
+    bool reparse_all();
+
+public:
+    explicit IncrementalDocument(std::string text, std::string file_path = "");
+
+    // Returns false if the edited text no longer parses. The message is then
+    // available from last_error() and the next edit reparses the whole file.
+    bool apply_edit(const TextEdit& edit);
+
+    std::string_view text() const { return source; }
+    const AST& ast() const { return nodes; }
+    const AstArena& ast_arena() const { return arena; }
+    size_t statement_count() const { return statements.size(); }
+    const std::optional<std::string>& last_error() const { return error; }
+};
@@ -1,7 +1,7 @@
 #include "../public/lexer.hpp"
 #include "lexer_core.hpp"
 
-std::vector<Token> tokenize(const std::string& input) {
-    LexerCore lexer(input);
+std::vector<Token> tokenize(std::string_view input, StringInterner& strings, bool throw_on_error) {
+    LexerCore lexer(input, strings, throw_on_error);
     return lexer.tokenize();
 }
@@ -1,18 +1,36 @@
 #include "lexer_core.hpp"
 #include <algorithm>
 
-LexerCore::LexerCore(const std::string& input) 
-    : position(0), size(input.size()), data(input.data()), input_ref(&input) {
+LexerCore::LexerCore(std::string_view input, StringInterner& strings, bool throw_on_error) 
+    : position(0), token_start(0), size(input.size()), data(input.data()), input(input), strings(strings),
+      throw_on_error(throw_on_error) {
     tokens.reserve(input.size() / 4); // Rough estimate to reduce reallocations
 }
 
+void LexerCore::emit(TokenType type, std::optional<std::string_view> value) {
+    tokens.emplace_back(type, static_cast<uint32_t>(token_start), value);
+}
+
+void LexerCore::fail(const std::string& message) {
+    if (throw_on_error) {
+        throw LexError(message, position);
+    }
+    report_lexer_error(message, position, input);
+}
+
 std::vector<Token> LexerCore::tokenize() {
+    // Token offsets are stored as 32 bits to keep Token at 32 bytes
+    if (size > UINT32_MAX) {
+        fail("Source file too large - inputs are limited to 4 GiB");
+    }
+    
     while (position < size) {
+        token_start = position;
         unsigned char c = static_cast<unsigned char>(data[position]);
         
-        // Skip whitespace efficiently using lookup table
+        // Skip whole whitespace runs at once (indentation, blank lines)
         if (is_space(c)) {
-            ++position;
+            position = skip_whitespace_run(data, position + 1, size);
             continue;
         }
         
@@ -46,7 +64,8 @@ std::vector<Token> LexerCore::tokenize() {
     
     // Add EOF token if not present
     if (tokens.empty() || tokens.back().type != TokenType::EndOfFile) {
-        tokens.emplace_back(TokenType::EndOfFile);
+        token_start = size;
+        emit(TokenType::EndOfFile);
     }
     
     return std::move(tokens);
@@ -56,19 +75,12 @@ void LexerCore::process_identifier() {
     size_t start = position;
     
     // Read identifier characters
-    while (position < size && is_identifier_char(static_cast<unsigned char>(data[position]))) {
-        ++position;
-    }
+    position = scan_identifier_run(data, position + 1, size);
     
-    std::string identifier(data + start, position - start);
+    std::string_view identifier(data + start, position - start);
     
-    // Check if it's a keyword
-    auto keyword_it = keywords.find(identifier);
-    if (keyword_it != keywords.end()) {
-        tokens.emplace_back(keyword_it->second, identifier);
-    } else {
-        tokens.emplace_back(TokenType::Identifier, identifier);
-    }
+    // Keywords keep their spelling as the token value
+    emit(classify_identifier(identifier), identifier);
 }
 
 void LexerCore::process_integer() {
@@ -94,12 +106,12 @@ void LexerCore::process_integer() {
         }
     }
     
-    std::string number(data + start, position - start);
+    std::string_view number(data + start, position - start);
     
     if (has_decimal) {
-        tokens.emplace_back(TokenType::FloatLiteral, number);
+        emit(TokenType::FloatLiteral, number);
     } else {
-        tokens.emplace_back(TokenType::IntegerLiteral, number);
+        emit(TokenType::IntegerLiteral, number);
     }
 }
 
@@ -116,52 +128,64 @@ void LexerCore::process_hex_literal() {
     
     // Check if we have at least one hex digit after 0x
     if (position == start + 2) {
-        report_lexer_error("Invalid hexadecimal literal - missing digits after '0x'", position, *input_ref);
+        fail("Invalid hexadecimal literal - missing digits after '0x'");
     }
     
-    std::string hex_number(data + start, position - start);
-    tokens.emplace_back(TokenType::HexLiteral, hex_number);
+    std::string_view hex_number(data + start, position - start);
+    emit(TokenType::HexLiteral, hex_number);
 }
 
 void LexerCore::process_string() {
     // Add opening quote token
-    tokens.emplace_back(TokenType::Quote);
+    emit(TokenType::Quote);
     ++position;
     
-    // Read string content until closing quote
-    std::string string_content;
+    // Fast path: literals without escapes are referenced in place
+    size_t start = position;
+    position = find_quote_or_escape(data, position, size);
     
-    while (position < size && data[position] != '"') {
-        if (data[position] == '\\' && position + 1 < size) {
-            // Handle escape sequences
-            ++position; // Skip backslash
-            switch (data[position]) {
-                case 'n': string_content += '\n'; break;
-                case 't': string_content += '\t'; break;
-                case 'r': string_content += '\r'; break;
-                case '\\': string_content += '\\'; break;
-                case '"': string_content += '"'; break;
-                default: 
-                    // Unknown escape sequence - keep both characters
-                    string_content += '\\';
-                    string_content += data[position];
-                    break;
+    std::string_view string_content(data + start, position - start);
+    
+    if (position < size && data[position] == '\\') {
+        // Escaped literal - materialize the decoded text into the interner
+        std::string decoded(string_content);
+        
+        while (position < size && data[position] != '"') {
+            if (data[position] == '\\' && position + 1 < size) {
+                // Handle escape sequences
+                ++position; // Skip backslash
+                switch (data[position]) {
+                    case 'n': decoded += '\n'; break;
+                    case 't': decoded += '\t'; break;
+                    case 'r': decoded += '\r'; break;
+                    case '\\': decoded += '\\'; break;
+                    case '"': decoded += '"'; break;
+                    default: 
+                        // Unknown escape sequence - keep both characters
+                        decoded += '\\';
+                        decoded += data[position];
+                        break;
+                }
+            } else {
+                decoded += data[position];
             }
-        } else {
-            string_content += data[position];
+            ++position;
         }
-        ++position;
+        
+        string_content = strings.intern(decoded);
     }
     
     if (position >= size) {
-        report_lexer_error("Unterminated string literal - missing closing quote", position, *input_ref);
+        fail("Unterminated string literal - missing closing quote");
     }
     
     // Add string content token
-    tokens.emplace_back(TokenType::String, string_content);
+    token_start = start;
+    emit(TokenType::String, string_content);
     
     // Add closing quote token
-    tokens.emplace_back(TokenType::Quote);
+    token_start = position;
+    emit(TokenType::Quote);
     ++position; // Skip closing quote
 }
 
@@ -170,147 +194,154 @@ void LexerCore::process_single_char_operators() {
     
     switch (c) {
         case '(':
-            tokens.emplace_back(TokenType::LeftParen);
+            emit(TokenType::LeftParen);
             ++position;
             break;
         case ')':
-            tokens.emplace_back(TokenType::RightParen);
+            emit(TokenType::RightParen);
             ++position;
             break;
         case '{':
-            tokens.emplace_back(TokenType::LeftBrace);
+            emit(TokenType::LeftBrace);
             ++position;
             break;
         case '}':
-            tokens.emplace_back(TokenType::RightBrace);
+            emit(TokenType::RightBrace);
+            ++position;
+            break;
+        case '[':
+            emit(TokenType::LeftBracket);
+            ++position;
+            break;
+        case ']':
+            emit(TokenType::RightBracket);
             ++position;
             break;
         case ';':
-            tokens.emplace_back(TokenType::Semicolon);
+            emit(TokenType::Semicolon);
             ++position;
             break;
         case ':':
-            tokens.emplace_back(TokenType::Colon);
+            emit(TokenType::Colon);
             ++position;
             break;
         case ',':
-            tokens.emplace_back(TokenType::Comma);
+            emit(TokenType::Comma);
             ++position;
             break;
         case '=':
             if (position + 1 < size && data[position + 1] == '=') {
-                tokens.emplace_back(TokenType::EqualEqual);
+                emit(TokenType::EqualEqual);
                 position += 2;
             } else {
-                tokens.emplace_back(TokenType::Equal);
+                emit(TokenType::Equal);
                 ++position;
             }
             break;
         case '!':
             if (position + 1 < size && data[position + 1] == '=') {
-                tokens.emplace_back(TokenType::NotEqual);
+                emit(TokenType::NotEqual);
                 position += 2;
             } else {
-                tokens.emplace_back(TokenType::Not);
+                emit(TokenType::Not);
                 ++position;
             }
             break;
         case '<':
             if (position + 1 < size && data[position + 1] == '=') {
-                tokens.emplace_back(TokenType::LessThanEqual);
+                emit(TokenType::LessThanEqual);
                 position += 2;
             } else if (position + 1 < size && data[position + 1] == '<') {
-                tokens.emplace_back(TokenType::LeftShift);
+                emit(TokenType::LeftShift);
                 position += 2;
             } else {
-                tokens.emplace_back(TokenType::LessThan);
+                emit(TokenType::LessThan);
                 ++position;
             }
             break;
         case '>':
             if (position + 1 < size && data[position + 1] == '=') {
-                tokens.emplace_back(TokenType::GreaterThanEqual);
+                emit(TokenType::GreaterThanEqual);
                 position += 2;
             } else if (position + 1 < size && data[position + 1] == '>') {
-                tokens.emplace_back(TokenType::RightShift);
+                emit(TokenType::RightShift);
                 position += 2;
             } else {
-                tokens.emplace_back(TokenType::GreaterThan);
+                emit(TokenType::GreaterThan);
                 ++position;
             }
             break;
         case '&':
             if (position + 1 < size && data[position + 1] == '&') {
-                tokens.emplace_back(TokenType::And);
+                emit(TokenType::And);
                 position += 2;
             } else {
-                tokens.emplace_back(TokenType::BitwiseAnd);
+                emit(TokenType::BitwiseAnd);
                 ++position;
             }
             break;
         case '|':
             if (position + 1 < size && data[position + 1] == '|') {
-                tokens.emplace_back(TokenType::Or);
+                emit(TokenType::Or);
                 position += 2;
             } else {
-                tokens.emplace_back(TokenType::BitwiseOr);
+                emit(TokenType::BitwiseOr);
                 ++position;
             }
             break;
         case '/':
             if (position + 1 < size && data[position + 1] == '/') {
                 // Single-line comment
-                tokens.emplace_back(TokenType::Comment);
+                emit(TokenType::Comment);
                 position += 2;
                 
                 // Skip to end of line
-                while (position < size && data[position] != '\n') {
-                    ++position;
-                }
+                position = find_line_end(data, position, size);
             } else if (position + 1 < size && data[position + 1] == '*') {
                 // Multiline comment start
-                tokens.emplace_back(TokenType::MultilineComment);
+                emit(TokenType::MultilineComment);
                 position += 2; // Skip /*
                 
-                // Read comment content
-                std::string comment_content = read_multiline_comment(*input_ref, position);
+                // Skip comment content
+                skip_multiline_comment(input, position);
                 
                 // Check if we found the end (*\)
                 if (position + 1 < size && data[position] == '*' && data[position + 1] == '\\') {                    
                     // Add end multiline comment token
-                    tokens.emplace_back(TokenType::EndMultilineComment);
+                    token_start = position;
+                    emit(TokenType::EndMultilineComment);
                     position += 2; // Skip *\
                 } else {
-                    report_lexer_error("Unterminated multiline comment - missing closing '*/'", position, *input_ref);
+                    fail("Unterminated multiline comment - missing closing '*/'");
                 }
             } else {
                 // Division operator
-                tokens.emplace_back(TokenType::Divide);
+                emit(TokenType::Divide);
                 ++position;
             }
             break;
         case '+':
-            tokens.emplace_back(TokenType::Plus);
+            emit(TokenType::Plus);
             ++position;
             break;
         case '-':
-            tokens.emplace_back(TokenType::Minus);
+            emit(TokenType::Minus);
             ++position;
             break;
         case '*':
-            tokens.emplace_back(TokenType::Multiply);
+            emit(TokenType::Multiply);
             ++position;
             break;
         case '%':
-            tokens.emplace_back(TokenType::Modulo);
+            emit(TokenType::Modulo);
             ++position;
             break;
         case '^':
-            tokens.emplace_back(TokenType::BitwiseXor);
+            emit(TokenType::BitwiseXor);
             ++position;
             break;
         case '.':
-            tokens.emplace_back(TokenType::Dot);
+            emit(TokenType::Dot);
             ++position;
             break;
         default:
@@ -324,6 +355,6 @@ void LexerCore::process_single_char_operators() {
                 suggestion = " - did you mean '\"' for a string?";
             }
             
-            report_lexer_error("Unexpected character '" + std::string(1, c) + "'" + suggestion, position, *input_ref);
+            fail("Unexpected character '" + std::string(1, c) + "'" + suggestion);
     }
 }
@@ -1,16 +1,24 @@
 #pragma once
-#include "../public/token.hpp"
+#include "../public/lexer.hpp"
 #include "lexer_helpers.hpp"
+#include "lexer_simd.hpp"
+#include "../public/string_interner.hpp"
 #include <vector>
-#include <string>
+#include <string_view>
 
 class LexerCore {
 private:
     std::vector<Token> tokens;
     size_t position;
+    size_t token_start;
     size_t size;
     const char* data;
-    const std::string* input_ref;
+    std::string_view input;
+    StringInterner& strings;
+    bool throw_on_error;
+
+    void emit(TokenType type, std::optional<std::string_view> value = std::nullopt);
+    [[noreturn]] void fail(const std::string& message);
 
     // Token creation methods
     void process_identifier();
@@ -22,6 +30,6 @@ private:
     void process_comments();
 
 public:
-    explicit LexerCore(const std::string& input);
+    LexerCore(std::string_view input, StringInterner& strings, bool throw_on_error = false);
     std::vector<Token> tokenize();
 };
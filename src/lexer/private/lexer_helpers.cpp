@@ -84,40 +84,37 @@ const std::array<bool, 256> digit_table = make_digit_table();
 const std::array<bool, 256> hex_digit_table = make_hex_digit_table();
 const std::array<bool, 256> space_table = make_space_table();
 
-const std::unordered_map<std::string_view, TokenType> keywords = {
-    {"return",   TokenType::KeywordReturn},
-    {"print",    TokenType::KeywordPrint},
-    {"println",  TokenType::KeywordPrintln},
-    {"asm",      TokenType::KeywordAsm},
-    {"pub",      TokenType::KeywordPub},
-    {"fn",       TokenType::Function},
-    {"let",      TokenType::KeywordLet},
-    {"if",       TokenType::KeywordIf},
-    {"else",     TokenType::KeywordElse},
-    {"elif",     TokenType::KeywordElif},
-    {"while",    TokenType::KeywordWhile},
-    {"for",      TokenType::KeywordFor},
-    {"mod",      TokenType::KeywordMod},
-    {"struct",   TokenType::KeywordStruct},
-    {"as",       TokenType::KeywordAs},
-    {"true",     TokenType::BooleanLiteral},
-    {"false",    TokenType::BooleanLiteral},
-    {"u8",       TokenType::U8},
-    {"u16",      TokenType::U16},
-    {"u32",      TokenType::U32},
-    {"u64",      TokenType::U64},
-    {"i8",       TokenType::I8},
-    {"i16",      TokenType::I16},
-    {"i32",      TokenType::I32},
-    {"i64",      TokenType::I64},
-};
-
+// Compile-time checks that classify_identifier agrees with keyword_entries
+// for every keyword and rejects near misses
+constexpr bool all_keywords_classified() {
+    for (const auto& entry : keyword_entries) {
+        if (classify_identifier(entry.spelling) != entry.type) {
+            return false;
+        }
+    }
+    return true;
+}
 
+static_assert(all_keywords_classified());
+static_assert(classify_identifier("x") == TokenType::Identifier);
+static_assert(classify_identifier("prin") == TokenType::Identifier);
+static_assert(classify_identifier("printl") == TokenType::Identifier);
+static_assert(classify_identifier("println_") == TokenType::Identifier);
+static_assert(classify_identifier("returns") == TokenType::Identifier);
+static_assert(classify_identifier("fnn") == TokenType::Identifier);
+static_assert(classify_identifier("iff") == TokenType::Identifier);
+static_assert(classify_identifier("elsif") == TokenType::Identifier);
+static_assert(classify_identifier("u128") == TokenType::Identifier);
+static_assert(classify_identifier("i9") == TokenType::Identifier);
+static_assert(classify_identifier("u8_") == TokenType::Identifier);
+static_assert(classify_identifier("trUe") == TokenType::Identifier);
+static_assert(classify_identifier("fals") == TokenType::Identifier);
+static_assert(classify_identifier("structs") == TokenType::Identifier);
+static_assert(classify_identifier("ass") == TokenType::Identifier);
 
-std::string read_multiline_comment(const std::string& input, size_t& i) {
+void skip_multiline_comment(std::string_view input, size_t& i) {
     const char* data = input.data();
     size_t size = input.size();
-    std::string content;
     
     while (i < size) {
         // Check for end of multiline comment (*\)
@@ -125,14 +122,11 @@ std::string read_multiline_comment(const std::string& input, size_t& i) {
             // Found end of comment (*\)
             break;
         }
-        content += data[i];
         ++i;
     }
-    
-    return content;
 }
 
-[[noreturn]] void report_lexer_error(const std::string& message, size_t position, const std::string& input) {
+[[noreturn]] void report_lexer_error(const std::string& message, size_t position, std::string_view input) {
     std::cerr << "\nLexer Error at position " << position << ":\n";
     std::cerr << "   " << message << "\n";
     
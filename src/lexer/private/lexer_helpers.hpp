@@ -1,7 +1,8 @@
 #pragma once
 #include "../public/token.hpp"
 #include <array>
-#include <unordered_map>
+#include <cstdint>
+#include <string>
 #include <string_view>
 
 // Character classification tables for fast lookup
@@ -26,8 +27,117 @@ inline bool is_hex_digit(unsigned char c) { return hex_digit_table[c]; }
 inline bool is_space(unsigned char c) { return space_table[c]; }
 
 // Keywords mapping
-extern const std::unordered_map<std::string_view, TokenType> keywords;
+struct KeywordEntry {
+    std::string_view spelling;
+    TokenType type;
+};
+
+inline constexpr std::array<KeywordEntry, 25> keyword_entries = {{
+    {"return",   TokenType::KeywordReturn},
+    {"print",    TokenType::KeywordPrint},
+    {"println",  TokenType::KeywordPrintln},
+    {"asm",      TokenType::KeywordAsm},
+    {"pub",      TokenType::KeywordPub},
+    {"fn",       TokenType::Function},
+    {"let",      TokenType::KeywordLet},
+    {"if",       TokenType::KeywordIf},
+    {"else",     TokenType::KeywordElse},
+    {"elif",     TokenType::KeywordElif},
+    {"while",    TokenType::KeywordWhile},
+    {"for",      TokenType::KeywordFor},
+    {"mod",      TokenType::KeywordMod},
+    {"struct",   TokenType::KeywordStruct},
+    {"as",       TokenType::KeywordAs},
+    {"true",     TokenType::BooleanLiteral},
+    {"false",    TokenType::BooleanLiteral},
+    {"u8",       TokenType::U8},
+    {"u16",      TokenType::U16},
+    {"u32",      TokenType::U32},
+    {"u64",      TokenType::U64},
+    {"i8",       TokenType::I8},
+    {"i16",      TokenType::I16},
+    {"i32",      TokenType::I32},
+    {"i64",      TokenType::I64},
+}};
+
+// Perfect hash over the keyword set: (first char, last char, length) is
+// unique per keyword, and the multipliers that make it collision-free in a
+// 64-slot table are searched at compile time.
+inline constexpr size_t keyword_table_size = 64;
+
+struct KeywordHashParams {
+    uint32_t first_mul;
+    uint32_t last_mul;
+};
+
+constexpr size_t keyword_hash(std::string_view word, KeywordHashParams params) {
+    return (static_cast<unsigned char>(word.front()) * params.first_mul +
+            static_cast<unsigned char>(word.back()) * params.last_mul +
+            word.size()) % keyword_table_size;
+}
+
+constexpr KeywordHashParams find_keyword_hash_params() {
+    for (uint32_t first_mul = 1; first_mul < 256; ++first_mul) {
+        for (uint32_t last_mul = 1; last_mul < 256; ++last_mul) {
+            std::array<bool, keyword_table_size> used{};
+            bool collision = false;
+            for (const auto& entry : keyword_entries) {
+                size_t slot = keyword_hash(entry.spelling, {first_mul, last_mul});
+                if (used[slot]) {
+                    collision = true;
+                    break;
+                }
+                used[slot] = true;
+            }
+            if (!collision) {
+                return {first_mul, last_mul};
+            }
+        }
+    }
+    return {0, 0};
+}
+
+inline constexpr KeywordHashParams keyword_hash_params = find_keyword_hash_params();
+static_assert(keyword_hash_params.first_mul != 0, "no collision-free keyword hash found; grow keyword_table_size");
+
+// Slot -> index into keyword_entries, or -1 for an empty slot
+constexpr std::array<int8_t, keyword_table_size> make_keyword_slots() {
+    std::array<int8_t, keyword_table_size> slots{};
+    for (auto& slot : slots) {
+        slot = -1;
+    }
+    for (size_t i = 0; i < keyword_entries.size(); ++i) {
+        slots[keyword_hash(keyword_entries[i].spelling, keyword_hash_params)] = static_cast<int8_t>(i);
+    }
+    return slots;
+}
+
+inline constexpr std::array<int8_t, keyword_table_size> keyword_slots = make_keyword_slots();
+
+constexpr size_t make_max_keyword_length() {
+    size_t longest = 0;
+    for (const auto& entry : keyword_entries) {
+        longest = entry.spelling.size() > longest ? entry.spelling.size() : longest;
+    }
+    return longest;
+}
+
+// Longer words cannot be keywords and skip the hash
+inline constexpr size_t max_keyword_length = make_max_keyword_length();
+
+// Returns the keyword token type for `word`, or TokenType::Identifier.
+// One hash and at most one string compare; no allocation.
+constexpr TokenType classify_identifier(std::string_view word) {
+    if (word.empty() || word.size() > max_keyword_length) {
+        return TokenType::Identifier;
+    }
+    int8_t index = keyword_slots[keyword_hash(word, keyword_hash_params)];
+    if (index >= 0 && keyword_entries[index].spelling == word) {
+        return keyword_entries[index].type;
+    }
+    return TokenType::Identifier;
+}
 
 // Helper functions
-std::string read_multiline_comment(const std::string& input, size_t& i);
-[[noreturn]] void report_lexer_error(const std::string& message, size_t position, const std::string& input);
+void skip_multiline_comment(std::string_view input, size_t& i);
+[[noreturn]] void report_lexer_error(const std::string& message, size_t position, std::string_view input);
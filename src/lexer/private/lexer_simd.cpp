@@ -0,0 +1,188 @@
+#include "lexer_simd.hpp"
+#include "lexer_helpers.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SIG_LEXER_X86 1
+#include <immintrin.h>
+#define SIG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Scalar kernels - also used for the tail of every vector scan
+
+static size_t skip_whitespace_scalar(const char* data, size_t pos, size_t size) {
+    while (pos < size && is_space(static_cast<unsigned char>(data[pos]))) ++pos;
+    return pos;
+}
+
+static size_t scan_identifier_scalar(const char* data, size_t pos, size_t size) {
+    while (pos < size && is_identifier_char(static_cast<unsigned char>(data[pos]))) ++pos;
+    return pos;
+}
+
+static size_t find_line_end_scalar(const char* data, size_t pos, size_t size) {
+    while (pos < size && data[pos] != '\n') ++pos;
+    return pos;
+}
+
+static size_t find_quote_or_escape_scalar(const char* data, size_t pos, size_t size) {
+    while (pos < size && data[pos] != '"' && data[pos] != '\\') ++pos;
+    return pos;
+}
+
+#ifdef SIG_LEXER_X86
+
+// SSE2 kernels (16 bytes per step). Character ranges are tested with the
+// unsigned-min trick: (c - lo) is in [0, hi - lo] iff min(c - lo, hi - lo) == c - lo.
+
+static inline __m128i in_range_sse2(__m128i c, char lo, char hi) {
+    __m128i shifted = _mm_sub_epi8(c, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(hi - lo))), shifted);
+}
+
+static inline __m128i whitespace_mask_sse2(__m128i c) {
+    // ' ' plus \t \n \v \f \r (9..13)
+    return _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), in_range_sse2(c, '\t', '\r'));
+}
+
+static inline __m128i identifier_mask_sse2(__m128i c) {
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    return _mm_or_si128(_mm_or_si128(in_range_sse2(lower, 'a', 'z'), in_range_sse2(c, '0', '9')),
+                        _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+}
+
+static size_t skip_whitespace_sse2(const char* data, size_t pos, size_t size) {
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace_mask_sse2(block))) & 0xFFFFu;
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+    return skip_whitespace_scalar(data, pos, size);
+}
+
+static size_t scan_identifier_sse2(const char* data, size_t pos, size_t size) {
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(identifier_mask_sse2(block))) & 0xFFFFu;
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+    return scan_identifier_scalar(data, pos, size);
+}
+
+static size_t find_line_end_sse2(const char* data, size_t pos, size_t size) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        unsigned hit = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        if (hit) return pos + __builtin_ctz(hit);
+    }
+    return find_line_end_scalar(data, pos, size);
+}
+
+static size_t find_quote_or_escape_sse2(const char* data, size_t pos, size_t size) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i match = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+        unsigned hit = static_cast<unsigned>(_mm_movemask_epi8(match));
+        if (hit) return pos + __builtin_ctz(hit);
+    }
+    return find_quote_or_escape_scalar(data, pos, size);
+}
+
+// AVX2 kernels (32 bytes per step), compiled for AVX2 regardless of the
+// baseline flags and only called when the CPU reports support
+
+SIG_TARGET_AVX2 static inline __m256i in_range_avx2(__m256i c, char lo, char hi) {
+    __m256i shifted = _mm256_sub_epi8(c, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(static_cast<char>(hi - lo))), shifted);
+}
+
+SIG_TARGET_AVX2 static size_t skip_whitespace_avx2(const char* data, size_t pos, size_t size) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(block, space), in_range_avx2(block, '\t', '\r'));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(match));
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+    return skip_whitespace_sse2(data, pos, size);
+}
+
+SIG_TARGET_AVX2 static size_t scan_identifier_avx2(const char* data, size_t pos, size_t size) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i underscore = _mm256_set1_epi8('_');
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i lower = _mm256_or_si256(block, case_bit);
+        __m256i match = _mm256_or_si256(_mm256_or_si256(in_range_avx2(lower, 'a', 'z'), in_range_avx2(block, '0', '9')),
+                                        _mm256_cmpeq_epi8(block, underscore));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(match));
+        if (stop) return pos + __builtin_ctz(stop);
+    }
+    return scan_identifier_sse2(data, pos, size);
+}
+
+SIG_TARGET_AVX2 static size_t find_line_end_avx2(const char* data, size_t pos, size_t size) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        unsigned hit = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        if (hit) return pos + __builtin_ctz(hit);
+    }
+    return find_line_end_sse2(data, pos, size);
+}
+
+SIG_TARGET_AVX2 static size_t find_quote_or_escape_avx2(const char* data, size_t pos, size_t size) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash));
+        unsigned hit = static_cast<unsigned>(_mm256_movemask_epi8(match));
+        if (hit) return pos + __builtin_ctz(hit);
+    }
+    return find_quote_or_escape_sse2(data, pos, size);
+}
+
+#endif // SIG_LEXER_X86
+
+// Runtime dispatch
+
+struct ScanKernels {
+    size_t (*skip_whitespace)(const char*, size_t, size_t);
+    size_t (*scan_identifier)(const char*, size_t, size_t);
+    size_t (*find_line_end)(const char*, size_t, size_t);
+    size_t (*find_quote_or_escape)(const char*, size_t, size_t);
+};
+
+static ScanKernels select_kernels() {
+#ifdef SIG_LEXER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {skip_whitespace_avx2, scan_identifier_avx2, find_line_end_avx2, find_quote_or_escape_avx2};
+    }
+    return {skip_whitespace_sse2, scan_identifier_sse2, find_line_end_sse2, find_quote_or_escape_sse2};
+#else
+    return {skip_whitespace_scalar, scan_identifier_scalar, find_line_end_scalar, find_quote_or_escape_scalar};
+#endif
+}
+
+static const ScanKernels active_kernels = select_kernels();
+
+size_t skip_whitespace_run(const char* data, size_t pos, size_t size) {
+    return active_kernels.skip_whitespace(data, pos, size);
+}
+
+size_t scan_identifier_run(const char* data, size_t pos, size_t size) {
+    return active_kernels.scan_identifier(data, pos, size);
+}
+
+size_t find_line_end(const char* data, size_t pos, size_t size) {
+    return active_kernels.find_line_end(data, pos, size);
+}
+
+size_t find_quote_or_escape(const char* data, size_t pos, size_t size) {
+    return active_kernels.find_quote_or_escape(data, pos, size);
+}
+
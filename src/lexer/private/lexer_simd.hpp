@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+// Block scanners for the lexer's hot loops. Each returns the index of the
+// first byte at or after `pos` that ends the scan, or `size` if none does.
+// The AVX2, SSE2 or scalar implementation is selected once at startup based
+// on the host CPU.
+size_t skip_whitespace_run(const char* data, size_t pos, size_t size);
+size_t scan_identifier_run(const char* data, size_t pos, size_t size);
+size_t find_line_end(const char* data, size_t pos, size_t size);
+size_t find_quote_or_escape(const char* data, size_t pos, size_t size);
+
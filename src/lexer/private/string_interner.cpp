@@ -0,0 +1,14 @@
+#include "../public/string_interner.hpp"
+
+std::string_view StringInterner::intern(std::string_view text) {
+    auto it = index.find(text);
+    if (it != index.end()) {
+        return *it;
+    }
+    
+    // std::deque never relocates existing elements on push_back, so views
+    // handed out earlier remain valid
+    std::string_view stored = storage.emplace_back(text);
+    index.insert(stored);
+    return stored;
+}
@@ -48,6 +48,8 @@ std::string tokenTypeToString(TokenType type) {
         case TokenType::RightParen: return "')'";
         case TokenType::LeftBrace: return "'{'";
         case TokenType::RightBrace: return "'}'";
+        case TokenType::LeftBracket: return "'['";
+        case TokenType::RightBracket: return "']'";
         case TokenType::Semicolon: return "';'";
         case TokenType::Colon: return "':'";
         case TokenType::Quote: return "'\"'";
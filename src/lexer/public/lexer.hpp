@@ -1,7 +1,19 @@
 #pragma once
 #include "token.hpp"
+#include "string_interner.hpp"
 #include <vector>
 #include <string>
+#include <string_view>
+#include <stdexcept>
 
-// Main tokenization function
-std::vector<Token> tokenize(const std::string& input);
\ No newline at end of file
+// Thrown instead of exiting when tokenizing with throw_on_error set
+struct LexError : std::runtime_error {
+    size_t position;
+    LexError(const std::string& message, size_t position)
+        : std::runtime_error(message), position(position) {}
+};
+
+// Main tokenization function. Tokens reference `input` directly, so the
+// buffer must stay alive as long as the tokens are in use. Errors are
+// reported and terminate the compiler unless throw_on_error is set.
+std::vector<Token> tokenize(std::string_view input, StringInterner& strings, bool throw_on_error = false);
@@ -0,0 +1,18 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+// Owns token text that cannot point back into the source buffer (string
+// literals with escape sequences). Each distinct spelling is stored once and
+// the returned views stay valid for the lifetime of the interner.
+class StringInterner {
+private:
+    std::deque<std::string> storage;
+    std::unordered_set<std::string_view> index;
+
+public:
+    std::string_view intern(std::string_view text);
+    size_t size() const { return storage.size(); }
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <optional>
+#include <cstdint>
 
 enum class TokenType {
     // Keywords
@@ -77,6 +79,8 @@ enum class TokenType {
     RightParen,
     LeftBrace,
     RightBrace,
+    LeftBracket,
+    RightBracket,
     Semicolon,
     Colon,
     Dot,          // . (member access)
@@ -94,9 +98,13 @@ enum class TokenType {
     EndOfFile
 };
 
+// Token text is a view into the source buffer passed to tokenize() (or into
+// the StringInterner for escaped string literals); both must outlive parsing.
+// `offset` is the byte offset of the token in that buffer.
 struct Token {
     TokenType type;
-    std::optional<std::string> value;
+    uint32_t offset;
+    std::optional<std::string_view> value;
 };
 
 // Helper function to convert TokenType to string for debugging
@@ -1,6 +1,4 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <cstdlib>
 #include "args.hpp"
@@ -8,17 +6,11 @@
 #include <parser/public/parser.hpp>
 #include <codegen/public/codegen.hpp>
 #include <modules/public/module_resolver.hpp>
-
-std::string read_file(const std::string& path) {
-    std::ifstream in(path);
-    if (!in) {
-        std::cerr << "Could not open file: " << path << "\n";
-        std::exit(1);
-    }
-    std::stringstream ss;
-    ss << in.rdbuf();
-    return ss.str();
-}
+#include <sema/public/type_inference.hpp>
+#include <source/public/source_manager.hpp>
+#include <cache/public/parse_cache.hpp>
+#include <cache/public/object_cache.hpp>
+#include <optional>
 
 int main(int argc, char* argv[]) {
     CompilerArgs args = parse_args(argc, argv);
@@ -33,15 +25,57 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
-    std::string code = read_file(args.input_file);
-    auto tokens = tokenize(code);
-    auto ast = parse(tokens, args.input_file);
+    // Owns the mapped sources for the rest of the run so token text and
+    // diagnostics can keep pointing into them
+    SourceManager sources;
+    const SourceFile* main_source = sources.load(args.input_file);
+    if (!main_source) {
+        std::cerr << "Could not open file: " << args.input_file << "\n";
+        std::exit(1);
+    }
+    
+    auto tokens = tokenize(main_source->text(), sources.strings());
+    AstArena arena;
+    auto ast = parse(tokens, arena, args.input_file);
+    
+    std::filesystem::path cache_dir = args.cache_dir.empty() ? ParseCache::default_directory()
+                                                             : std::filesystem::path(args.cache_dir);
+    std::optional<ParseCache> cache;
+    if (!args.no_cache) {
+        cache.emplace(cache_dir);
+    }
     
-    ModuleResolver resolver;
+    ModuleResolver resolver(sources, arena, cache && cache->enabled() ? &*cache : nullptr);
     auto resolved_ast = resolver.resolve_modules(ast, args.input_file);
     
+    if (args.cache_stats) {
+        if (cache && cache->enabled()) {
+            std::cerr << "Parse cache: " << cache->hits() << " hit(s), " << cache->misses()
+                      << " miss(es) in " << cache->path().string() << "\n";
+        } else {
+            std::cerr << "Parse cache: disabled\n";
+        }
+    }
+    
+    if (!infer_types(arena, resolved_ast)) {
+        std::exit(1);
+    }
+    
     CodeGen codegen(args.target_32bit, args.no_std);
-    codegen.compile(resolved_ast);
+    codegen.set_optimization_level(args.opt_level, args.optimize_size);
+    codegen.set_lazy_jit(args.lazy_jit, args.jit_threads);
+    if (args.tiered_jit) {
+        codegen.set_tiered_jit(args.tier_threshold, args.jit_stats);
+    }
+    if (!args.target_cpu.empty() || !args.target_features.empty()) {
+        codegen.set_target_cpu(args.target_cpu, args.target_features);
+    }
+    std::optional<JitObjectCache> object_cache;
+    if (!args.no_cache && args.mode == "jit" && !cache_dir.empty()) {
+        object_cache.emplace(cache_dir / "jit");
+        codegen.set_object_cache(&*object_cache);
+    }
+    codegen.compile(arena, resolved_ast);
     
     if (args.mode == "ir") {
         std::cout << "Generated LLVM IR:\n";
@@ -49,6 +83,14 @@ int main(int argc, char* argv[]) {
     } else if (args.mode == "jit") {
         std::cout << "Executing with LLVM JIT:\n";
         codegen.execute();
+        if (args.cache_stats) {
+            if (object_cache && object_cache->enabled()) {
+                std::cerr << "JIT object cache: " << object_cache->hits() << " hit(s), " << object_cache->misses()
+                          << " miss(es) in " << object_cache->path().string() << "\n";
+            } else {
+                std::cerr << "JIT object cache: disabled\n";
+            }
+        }
     } else {
         std::cout << "Compiling " << args.input_file << " to " << args.output_name << "...\n";
         if (args.object_only) {
@@ -1,134 +1,212 @@
 #include "../public/module_resolver.hpp"
 #include <parser/public/parser.hpp>
 #include <lexer/public/lexer.hpp>
+#include <concurrency/public/work_stealing_pool.hpp>
+#include <cache/public/parse_cache.hpp>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <filesystem>
+#include <thread>
 
-std::string read_module_file(const std::string& path) {
-    std::ifstream in(path);
-    if (!in) {
-        std::cerr << "Could not open module file: " << path << "\n";
-        std::exit(1);
+AST ModuleResolver::resolve_modules(const AST& main_ast, const std::string& main_file_path) {
+    std::vector<Symbol> main_imports;
+    find_all_modules(arena, main_ast, main_imports);
+    if (main_imports.empty()) {
+        return main_ast; // No modules to resolve
     }
-    std::stringstream ss;
-    ss << in.rdbuf();
-    return ss.str();
+    
+    // Step 1: Read and parse every reachable module in parallel. With a
+    // single hardware thread, step 2 parses each module on demand instead.
+    if (std::thread::hardware_concurrency() > 1) {
+        WorkStealingPool pool;
+        for (Symbol path : main_imports) {
+            parse_ahead(arena.symbols.name(path), pool);
+        }
+        pool.wait();
+    }
+    
+    // Step 2: Walk the graph in source order, taking each module exactly once
+    load_imports(main_ast);
+    
+    // Step 3: Replace top-level mod statements with the module contents
+    AST final_ast;
+    final_ast.reserve(main_ast.size());
+    append_resolved(main_ast, final_ast);
+    return final_ast;
 }
 
-AST ModuleResolver::resolve_modules(const AST& main_ast, const std::string& main_file_path) {
-    // Step 1: Find all module references
-    std::vector<std::string> module_paths;
-    find_all_modules(main_ast, module_paths);
+// Depth-first over the imports of `ast`. Returns false if it has none.
+bool ModuleResolver::load_imports(const AST& ast) {
+    std::vector<Symbol> module_paths;
+    find_all_modules(arena, ast, module_paths);
     
     if (module_paths.empty()) {
-        return main_ast; // No modules to resolve
+        return false;
     }
     
     std::cout << "Found " << module_paths.size() << " module(s) to resolve\n";
     
-    // Step 2: Load and parse each module
-    for (const std::string& module_path : module_paths) {
-        if (loaded_modules.find(module_path) == loaded_modules.end()) {
+    for (Symbol path : module_paths) {
+        auto [it, inserted] = module_ids.try_emplace(path, static_cast<uint32_t>(modules.size()));
+        const std::string& module_path = arena.symbols.name(path);
+        
+        if (!inserted) {
             // Check for circular dependency
-            if (loading_modules.find(module_path) != loading_modules.end()) {
+            if (modules[it->second].state == ModuleState::Loading) {
                 std::cerr << "Error: Circular dependency detected for module: " << module_path << "\n";
                 std::exit(1);
             }
-            
-            std::cout << "Loading module: " << module_path << "\n";
-            loading_modules.insert(module_path);
-            
-            AST module_ast = load_and_parse_module(module_path);
-            
-            // Recursively resolve modules in this module
-            ModuleResolver recursive_resolver;
-            recursive_resolver.loaded_modules = loaded_modules;
-            recursive_resolver.loading_modules = loading_modules;
-            module_ast = recursive_resolver.resolve_modules(module_ast, module_path);
-            
-            // Update our state from recursive resolution
-            loaded_modules = recursive_resolver.loaded_modules;
-            loading_modules = recursive_resolver.loading_modules;
-            
-            loaded_modules[module_path] = module_ast;
-            loading_modules.erase(module_path);
+            continue;
+        }
+        
+        std::cout << "Loading module: " << module_path << "\n";
+        uint32_t id = it->second;
+        modules.push_back(Module{{}, ModuleState::Loading});
+        
+        AST module_ast = take_module(module_path);
+        load_imports(module_ast);
+        
+        modules[id].ast = std::move(module_ast);
+        modules[id].state = ModuleState::Loaded;
+    }
+    
+    return true;
+}
+
+// Runs on a pool worker: parses one module into a private arena, then queues
+// every module it imports that nobody has claimed yet
+void ModuleResolver::parse_ahead(const std::string& module_path, WorkStealingPool& pool) {
+    {
+        std::lock_guard<std::mutex> lock(parsed_mutex);
+        if (!parsed_modules.try_emplace(module_path).second) {
+            return; // Already claimed through another import
+        }
+    }
+    
+    pool.submit([this, module_path, &pool] {
+        auto parsed = std::make_unique<ParsedModule>();
+        ParsedModule* module = parsed.get();
+        
+        const SourceFile* source = sources.load(module_path);
+        if (source) {
+            try {
+                if (!cache || !cache->load(module_path, source->text(), module->arena, module->ast)) {
+                    StringInterner strings;
+                    std::vector<StatementSpan> spans;
+                    auto tokens = tokenize(source->text(), strings, true);
+                    module->ast = parse_top_level(tokens, module->arena, module_path, spans);
+                    if (cache) {
+                        cache->store(module_path, source->text(), module->arena, module->ast);
+                    }
+                }
+            } catch (const std::exception&) {
+                // LexError, ParseError or anything else the parser throws
+                module->failed = true;
+            }
+        } else {
+            module->failed = true;
+        }
+        
+        std::vector<Symbol> imports;
+        if (!module->failed) {
+            find_all_modules(module->arena, module->ast, imports);
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(parsed_mutex);
+            parsed_modules[module_path] = std::move(parsed);
+        }
+        
+        for (Symbol import : imports) {
+            parse_ahead(module->arena.symbols.name(import), pool);
         }
+    });
+}
+
+AST ModuleResolver::take_module(const std::string& module_path) {
+    auto it = parsed_modules.find(module_path);
+    if (it == parsed_modules.end() || !it->second || it->second->failed) {
+        // Parse again on this thread so errors are reported as usual
+        return load_and_parse_module(module_path);
     }
     
-    // Step 3: Merge all ASTs
-    return merge_asts(main_ast, loaded_modules);
+    ParsedModule& parsed = *it->second;
+    AST module_ast = arena.absorb(std::move(parsed.arena), parsed.ast);
+    it->second.reset();
+    return module_ast;
 }
 
-void ModuleResolver::find_all_modules(const AST& ast, std::vector<std::string>& module_paths) {
+void ModuleResolver::find_all_modules(const AstArena& ast_arena, const AST& ast, std::vector<Symbol>& module_paths) {
     for (const auto& node : ast) {
-        find_modules_in_node(node, module_paths);
+        find_modules_in_node(ast_arena, node, module_paths);
     }
 }
 
-void ModuleResolver::find_modules_in_node(const ASTNode& node, std::vector<std::string>& module_paths) {
-    std::visit([&](const auto& stmt) {
+void ModuleResolver::find_modules_in_node(const AstArena& ast_arena, NodeRef node, std::vector<Symbol>& module_paths) {
+    auto find_in_block = [&](Range<NodeRef> block) {
+        for (NodeRef child : ast_arena.list(block)) {
+            find_modules_in_node(ast_arena, child, module_paths);
+        }
+    };
+
+    ast_arena.visit(node, [&](const auto& stmt) {
         using T = std::decay_t<decltype(stmt)>;
         
         if constexpr (std::is_same_v<T, ModStatement>) {
             module_paths.push_back(stmt.filename);
         }
         else if constexpr (std::is_same_v<T, FunctionDefinition>) {
-            find_all_modules(stmt.body, module_paths);
+            find_in_block(stmt.body);
         }
         else if constexpr (std::is_same_v<T, IfStatement>) {
-            find_all_modules(stmt.thenBlock, module_paths);
-            for (const auto& elif : stmt.elifClauses) {
-                find_all_modules(elif.block, module_paths);
+            find_in_block(stmt.thenBlock);
+            for (const auto& elif : ast_arena.list(stmt.elifClauses)) {
+                find_in_block(elif.block);
             }
             if (stmt.elseBlock.has_value()) {
-                find_all_modules(stmt.elseBlock.value(), module_paths);
+                find_in_block(stmt.elseBlock.value());
             }
         }
         else if constexpr (std::is_same_v<T, WhileStatement>) {
-            find_all_modules(stmt.body, module_paths);
+            find_in_block(stmt.body);
         }
         else if constexpr (std::is_same_v<T, ForStatement>) {
-            find_all_modules(stmt.body, module_paths);
+            find_in_block(stmt.body);
         }
         // Other statement types don't contain nested statements
-    }, node);
+    });
 }
 
 AST ModuleResolver::load_and_parse_module(const std::string& module_path) {
-    std::string module_code = read_module_file(module_path);
-    auto tokens = tokenize(module_code);
-    return parse(tokens, module_path);
-}
-
-AST ModuleResolver::merge_asts(const AST& main_ast, const std::unordered_map<std::string, AST>& modules) {
-    AST merged_ast = main_ast;
-    
-    // Remove ModStatement nodes from main AST and replace with actual module content
-    AST final_ast;
+    const SourceFile* source = sources.load(module_path);
+    if (!source) {
+        std::cerr << "Could not open module file: " << module_path << "\n";
+        std::exit(1);
+    }
     
-    for (const auto& node : main_ast) {
-        std::visit([&](const auto& stmt) {
-            using T = std::decay_t<decltype(stmt)>;
-            
-            if constexpr (std::is_same_v<T, ModStatement>) {
-                // Replace module statement with actual module content
-                auto it = modules.find(stmt.filename);
-                if (it != modules.end()) {
-                    // Add all statements from the module (except ModStatements)
-                    for (const auto& module_node : it->second) {
-                        if (!std::holds_alternative<ModStatement>(module_node)) {
-                            final_ast.push_back(module_node);
-                        }
-                    }
-                }
-            } else {
-                // Keep the original statement
-                final_ast.push_back(node);
-            }
-        }, node);
+    if (!cache) {
+        auto tokens = tokenize(source->text(), sources.strings());
+        return parse(tokens, arena, module_path);
     }
     
-    return final_ast;
-}
\ No newline at end of file
+    // Cache entries are self-contained, so parse into a private arena
+    AstArena module_arena;
+    AST module_ast;
+    if (!cache->load(module_path, source->text(), module_arena, module_ast)) {
+        auto tokens = tokenize(source->text(), sources.strings());
+        module_ast = parse(tokens, module_arena, module_path);
+        cache->store(module_path, source->text(), module_arena, module_ast);
+    }
+    return arena.absorb(std::move(module_arena), module_ast);
+}
+
+void ModuleResolver::append_resolved(const AST& ast, AST& out) const {
+    for (NodeRef node : ast) {
+        if (arena.holds<ModStatement>(node)) {
+            // Every module was loaded by load_imports, so the lookup cannot fail
+            const Module& module = modules[module_ids.at(arena.get<ModStatement>(node).filename)];
+            append_resolved(module.ast, out);
+        } else {
+            out.push_back(node);
+        }
+    }
+}
@@ -1,19 +1,64 @@
 #pragma once
 #include <ast/public/ast_simple.hpp>
+#include <source/public/source_manager.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
+class WorkStealingPool;
+class ParseCache;
+
+// Loads every module reachable through `mod` statements and splices their
+// statements into the importing file. The module graph owns each parsed
+// module exactly once; splicing only copies NodeRefs into the output.
+//
+// Modules are read and parsed concurrently into private arenas first. The
+// graph is then walked on the calling thread in source order, absorbing each
+// module into the shared arena, so merge order, progress output and cycle
+// detection are the same as a sequential load.
 class ModuleResolver {
 private:
-    std::unordered_map<std::string, AST> loaded_modules;
-    std::unordered_set<std::string> loading_modules;
+    enum class ModuleState : uint8_t {
+        Loading,    // on the current import path, so seeing it again is a cycle
+        Loaded
+    };
+
+    struct Module {
+        AST ast;
+        ModuleState state;
+    };
+
+    // A module parsed ahead of time on a worker thread
+    struct ParsedModule {
+        AstArena arena;
+        AST ast;
+        bool failed = false;  // parsed again on the calling thread to report the error
+    };
 
-    void find_all_modules(const AST& ast, std::vector<std::string>& module_paths);
-    void find_modules_in_node(const ASTNode& node, std::vector<std::string>& module_paths);
+    SourceManager& sources;
+    AstArena& arena;
+    ParseCache* cache;
+    std::vector<Module> modules;
+    std::unordered_map<Symbol, uint32_t, SymbolHash> module_ids;  // keyed by module path
+
+    std::mutex parsed_mutex;
+    std::unordered_map<std::string, std::unique_ptr<ParsedModule>> parsed_modules;
+
+    static void find_all_modules(const AstArena& ast_arena, const AST& ast, std::vector<Symbol>& module_paths);
+    static void find_modules_in_node(const AstArena& ast_arena, NodeRef node, std::vector<Symbol>& module_paths);
+    void parse_ahead(const std::string& module_path, WorkStealingPool& pool);
+    bool load_imports(const AST& ast);
+    AST take_module(const std::string& module_path);
     AST load_and_parse_module(const std::string& module_path);
-    AST merge_asts(const AST& main_ast, const std::unordered_map<std::string, AST>& modules);
+    void append_resolved(const AST& ast, AST& out) const;
 
 public:
+    // Modules are looked up in and added to `cache` when one is given
+    ModuleResolver(SourceManager& sources, AstArena& arena, ParseCache* cache = nullptr)
+        : sources(sources), arena(arena), cache(cache) {}
+
     AST resolve_modules(const AST& main_ast, const std::string& main_file_path);
 };
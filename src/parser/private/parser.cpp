@@ -5,18 +5,42 @@
 #include <limits>
 #include <cstdint>
 
-Parser::Parser(const std::vector<Token>& tokens, const std::string& file_path)
-    : tokens(tokens), current(0), size(tokens.size()), current_file_path(file_path) {}
+Parser::Parser(const std::vector<Token>& tokens, AstArena& arena, const std::string& file_path, bool throw_on_error)
+    : tokens(tokens), arena(arena), current(0), size(tokens.size()), current_file_path(file_path), throw_on_error(throw_on_error) {}
 
-int Parser::parseInteger(std::string_view str) const {
-    int value;
+// The digits of a decimal literal; a minus sign is a separate token
+uint64_t Parser::parseInteger(std::string_view str) const {
+    uint64_t value;
     auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (ec == std::errc::result_out_of_range) {
+        reportError("Integer literal '" + std::string(str) + "' is too large (max: " + std::to_string(UINT64_MAX) + ")");
+    }
     if (ec != std::errc{}) {
         reportError("Invalid integer format: '" + std::string(str) + "'. Expected a valid number like 42 or -123.");
     }
     return value;
 }
 
+// A decimal literal, negated when `negative`: a plain int when it fits in
+// i32, which lets it take the type of the other operand, and otherwise i64,
+// or u64 past the i64 range
+Expression Parser::integerLiteral(std::string_view str, bool negative) const {
+    uint64_t magnitude = parseInteger(str);
+    uint64_t int_limit = negative ? uint64_t{1} << 31 : INT32_MAX;
+    uint64_t i64_limit = negative ? uint64_t{1} << 63 : INT64_MAX;
+    if (magnitude <= int_limit) {
+        return static_cast<int>(negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude));
+    }
+    if (magnitude <= i64_limit) {
+        TypedValue literal{SigType::I64, negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude)};
+        return literal;
+    }
+    if (negative) {
+        reportError("Integer literal '-" + std::string(str) + "' is too small for i64 (min: " + std::to_string(INT64_MIN) + ")");
+    }
+    return TypedValue{SigType::U64, magnitude};
+}
+
 double Parser::parseDouble(std::string_view str) const {
     double value;
     auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
@@ -63,6 +87,41 @@ SigType Parser::parseTypeAnnotation() {
     }
 }
 
+// A scalar type, a struct name, [N]T for a fixed-size array or []T for a
+// slice. Arrays hold scalars or structs; `array` receives the element type
+// and length, and the struct's name.
+SigType Parser::parseVariableType(ArrayShape& array) {
+    if (hasTokens() && peekToken().type == TokenType::Identifier) {
+        array.record = intern(peekToken().value.value());
+        advance();
+        return SigType::Struct;
+    }
+    if (!hasTokens() || peekToken().type != TokenType::LeftBracket) {
+        return parseTypeAnnotation();
+    }
+    advance(); // consume '['
+
+    SigType type = SigType::Slice;
+    if (hasTokens() && peekToken().type == TokenType::IntegerLiteral) {
+        uint64_t length = parseInteger(peekToken().value.value());
+        if (length == 0 || length > UINT32_MAX) {
+            reportError("Array length must be from 1 to " + std::to_string(UINT32_MAX) + ", got " + std::to_string(length));
+        }
+        advance();
+        type = SigType::Array;
+        array.length = static_cast<uint32_t>(length);
+    }
+    expectToken(TokenType::RightBracket, "in array type. Expected [N]T or []T");
+    if (hasTokens() && peekToken().type == TokenType::Identifier) {
+        array.element = SigType::Struct;
+        array.record = intern(peekToken().value.value());
+        advance();
+    } else {
+        array.element = parseTypeAnnotation();
+    }
+    return type;
+}
+
 TypedValue Parser::createTypedValue(SigType type, uint64_t value) const {
     TypedValue typedValue;
     typedValue.type = type;
@@ -128,7 +187,7 @@ std::string Parser::getErrorContext() const {
         context += " (found " + tokenTypeToString(token.type);
         
         if (token.value.has_value() && !token.value.value().empty()) {
-            context += ": '" + token.value.value() + "'";
+            context += ": '" + std::string(token.value.value()) + "'";
         }
         context += ")";
     } else {
@@ -175,7 +234,8 @@ std::string Parser::getSuggestions() const {
             suggestions = "\nSuggestions:\n   • if (x == 5) { ... }\n   • if (name != \"test\") { ... }";
         }
         else if (prevToken.type == TokenType::Identifier && token.type != TokenType::LeftParen) {
-            suggestions = "\nDid you mean:\n   • " + prevToken.value.value_or("name") + "(); (function call)\n   • let " + prevToken.value.value_or("name") + " = value; (assignment)";
+            std::string name(prevToken.value.value_or("name"));
+            suggestions = "\nDid you mean:\n   • " + name + "(); (function call)\n   • let " + name + " = value; (assignment)";
         }
     }
     
@@ -183,6 +243,10 @@ std::string Parser::getSuggestions() const {
 }
 
 void Parser::reportError(const std::string& message) const {
+    if (throw_on_error) {
+        throw ParseError(message + " " + getErrorContext());
+    }
+    
     std::cerr << "\nParse Error " << getErrorContext() << ":\n";
     std::cerr << "   " << message << "\n";
     
@@ -247,7 +311,7 @@ void Parser::reportExpectedError(TokenType expected, const std::string& context)
     if (current < size) {
         message += ", but found " + tokenTypeToString(tokens[current].type);
         if (tokens[current].value.has_value()) {
-            message += " '" + tokens[current].value.value() + "'";
+            message += " '" + std::string(tokens[current].value.value()) + "'";
         }
     } else {
         message += ", but reached end of input";
@@ -325,16 +389,25 @@ void Parser::parseStatement(AST& ast) {
             if (hasTokens(2) && peekToken(1).type == TokenType::LeftParen) {
                 parseFunctionCall(ast);
             } else {
+                std::string name(token.value.value_or("name"));
                 std::string suggestion = "Did you mean to:\n"
-                                       "   • Call a function: " + token.value.value_or("name") + "();\n"
-                                       "   • Declare a variable: let " + token.value.value_or("name") + ";\n"
-                                       "   • Assign to a variable: let " + token.value.value_or("name") + " = value;";
-                reportError("Unexpected identifier '" + token.value.value_or("unknown") + "'.\n   " + suggestion);
+                                       "   • Call a function: " + name + "();\n"
+                                       "   • Declare a variable: let " + name + ";\n"
+                                       "   • Assign to a variable: let " + name + " = value;";
+                if (hasTokens(2) && peekToken(1).type == TokenType::LeftBracket) {
+                    suggestion += "\n   • Assign to an element: let " + name + "[index] = value;";
+                } else if (hasTokens(2) && peekToken(1).type == TokenType::Dot) {
+                    suggestion += "\n   • Assign to a field: let " + name + ".field = value;";
+                }
+                reportError("Unexpected identifier '" + std::string(token.value.value_or("unknown")) + "'.\n   " + suggestion);
             }
             break;
         case TokenType::KeywordLet:
             parseVariables(ast);
             break;
+        case TokenType::KeywordStruct:
+            parseStructDefinition(ast);
+            break;
         case TokenType::KeywordIf:
             parseIfStatement(ast);
             break;
@@ -359,7 +432,7 @@ void Parser::parseStatement(AST& ast) {
             break;
         default:
             reportError("Unexpected " + tokenTypeToString(token.type) + " at start of statement.\n"
-                       "   Expected one of: 'return', 'print', 'println', 'fn', 'let', 'asm', 'if', 'while', 'mod' or identifier");
+                       "   Expected one of: 'return', 'print', 'println', 'fn', 'let', 'struct', 'asm', 'if', 'while', 'mod' or identifier");
             advance();
             break;
     }
@@ -381,12 +454,33 @@ AST Parser::parse() {
     return ast;
 }
 
-AST parse(const std::vector<Token>& tokens, const std::string& file_path) {
+AST Parser::parseTopLevel(std::vector<StatementSpan>& spans) {
+    AST ast;
+    ast.reserve(tokens.size() / 3);
+
+    while (hasTokens() && peekToken().type != TokenType::EndOfFile) {
+        uint32_t offset = peekToken().offset;
+        size_t nodes_before = ast.size();
+        parseStatement(ast);
+        spans.push_back(StatementSpan{offset, ast.size() - nodes_before});
+    }
+
+    return ast;
+}
+
+AST parse(const std::vector<Token>& tokens, AstArena& arena, const std::string& file_path) {
     if (tokens.empty()) {
         std::cout << "Note: Input is empty, returning empty AST\n";
         return AST{};
     }
 
-    Parser parser(tokens, file_path);
+    Parser parser(tokens, arena, file_path);
     return parser.parse();
 }
+
+
+AST parse_top_level(const std::vector<Token>& tokens, AstArena& arena, const std::string& file_path,
+                    std::vector<StatementSpan>& spans) {
+    Parser parser(tokens, arena, file_path, true);
+    return parser.parseTopLevel(spans);
+}
\ No newline at end of file
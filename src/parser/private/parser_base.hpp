@@ -9,14 +9,18 @@
 class Parser {
 private:
     const std::vector<Token>& tokens;
+    AstArena& arena;
     size_t current;
     const size_t size;
     std::string current_file_path;
+    bool throw_on_error;
 
-    int parseInteger(std::string_view str) const;
+    uint64_t parseInteger(std::string_view str) const;
+    Expression integerLiteral(std::string_view str, bool negative) const;
     double parseDouble(std::string_view str) const;
     uint64_t parseHexLiteral(std::string_view str) const;
     SigType parseTypeAnnotation();
+    SigType parseVariableType(ArrayShape& array);
     TypedValue createTypedValue(SigType type, uint64_t value) const;
     std::string getErrorContext() const;
     void skipToRecoveryPoint();
@@ -25,13 +29,24 @@ private:
     void reportErrorWithRecovery(const std::string& message);
     [[noreturn]] void reportExpectedError(TokenType expected, const std::string& context = "") const;
 
+    Symbol intern(std::string_view text) { return arena.symbols.intern(text); }
+
     bool hasTokens(size_t count = 1) const;
     const Token& peekToken(size_t offset = 0) const;
     void advance(size_t count = 1);
     void expectToken(TokenType expected, const std::string& context = "");
+    bool atSingleValue(TokenType terminator) const;
+    Expression makeBinary(SigBinaryOperator op, Expression left, Expression right);
+    Expression parseArrayAccess(Symbol array);
+    Expression parseArrayLiteral();
+    Expression parseCall(Symbol function);
+    Expression parseStructLiteral(Symbol record);
+    Expression parseCondition(const std::string& statement);
+    Symbol parseFieldName();
+    void skipComments();
 
 public:
-    explicit Parser(const std::vector<Token>& tokens, const std::string& file_path = "");
+    Parser(const std::vector<Token>& tokens, AstArena& arena, const std::string& file_path = "", bool throw_on_error = false);
 
     void parseReturnStatement(AST& ast);
     void parsePrintStatement(AST& ast);
@@ -39,6 +54,7 @@ public:
     void parseFor(AST& ast);
     void parseFunctionDefinition(AST& ast);
     void parseFunctionCall(AST& ast);
+    void parseStructDefinition(AST& ast);
     void parseAsmStatement(AST& ast);
     void parseIfStatement(AST& ast);
     void parseWhile(AST& ast);
@@ -48,13 +64,19 @@ public:
     void parseStatement(AST& ast);
     void parseModStatement(AST& ast);
     void parseExpression(AST& ast);
-    BinaryExpression parseArithmeticExpression();
+    Expression parseArithmeticExpression();
     Expression parseFactor();
-    std::variant<UnaryExpression, Expression> parseUnaryExpression();
+    Expression parseUnaryExpression();
     Expression parseArithmeticTerm();
     Expression parseAdditiveExpression();
-    BinaryExpression parseComparisonExpression();
-    BinaryExpression parseLogicalAndExpression();
-    BinaryExpression parseLogicalOrExpression();
+    Expression parseShiftExpression();
+    Expression parseRelationalExpression();
+    Expression parseComparisonExpression();
+    Expression parseBitwiseAndExpression();
+    Expression parseBitwiseXorExpression();
+    Expression parseBitwiseOrExpression();
+    Expression parseLogicalAndExpression();
+    Expression parseLogicalOrExpression();
     AST parse();
+    AST parseTopLevel(std::vector<StatementSpan>& spans);
 };
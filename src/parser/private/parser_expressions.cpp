@@ -1,258 +1,414 @@
 #include "parser_base.hpp"
+#include <cstdint>
 
-// Parse a factor (number, variable, or parenthesized expression)
+Expression Parser::makeBinary(SigBinaryOperator op, Expression left, Expression right) {
+    ExprNode node;
+    node.kind = ExprKind::Binary;
+    node.op = op;
+    node.left = std::move(left);
+    node.right = std::move(right);
+    return arena.add_expression(std::move(node));
+}
+
+// Parse a factor (number, variable, array element, struct field, array or
+// struct literal, or parenthesized expression)
 Expression Parser::parseFactor() {
     if (!hasTokens()) {
         reportError("Expected expression but reached end of file");
     }
-    
+
     const Token& token = peekToken();
-    
+
     switch (token.type) {
         case TokenType::IntegerLiteral: {
-            int value = parseInteger(token.value.value());
+            Expression value = integerLiteral(token.value.value(), false);
             advance();
             return value;
         }
-        
+
+        case TokenType::HexLiteral: {
+            // u32 unless the value needs more bits
+            uint64_t value = parseHexLiteral(token.value.value());
+            advance();
+            return createTypedValue(value > UINT32_MAX ? SigType::U64 : SigType::U32, value);
+        }
+
         case TokenType::FloatLiteral: {
             double value = parseDouble(token.value.value());
             advance();
             return value;
         }
-        
+
         case TokenType::BooleanLiteral: {
             bool value = token.value.value() == "true";
             advance();
             return value;
         }
-        
+
         case TokenType::Identifier: {
-            std::string var_name = token.value.value();
+            ExprNode node;
+            node.kind = ExprKind::Variable;
+            node.name = intern(token.value.value());
             advance();
-            return var_name;
+            if (hasTokens() && peekToken().type == TokenType::LeftBracket) {
+                return parseArrayAccess(node.name);
+            }
+            if (hasTokens() && peekToken().type == TokenType::Dot) {
+                node.kind = ExprKind::Field;
+                node.field = parseFieldName();
+                return arena.add_expression(std::move(node));
+            }
+            // Name { field: ... } or the empty Name {}
+            if (hasTokens(2) && peekToken().type == TokenType::LeftBrace &&
+                (peekToken(1).type == TokenType::RightBrace ||
+                 (peekToken(1).type == TokenType::Identifier && hasTokens(3) && peekToken(2).type == TokenType::Colon))) {
+                return parseStructLiteral(node.name);
+            }
+            // len(name) reads the length of an array, slice or string
+            // variable; any other call is to a builtin
+            if (token.value.value() == "len" && hasTokens(3) && peekToken().type == TokenType::LeftParen &&
+                peekToken(1).type == TokenType::Identifier && peekToken(2).type == TokenType::RightParen) {
+                advance(); // consume '('
+                node.kind = ExprKind::Length;
+                node.name = intern(peekToken().value.value());
+                advance();
+                expectToken(TokenType::RightParen, "after len argument");
+            } else if (hasTokens() && peekToken().type == TokenType::LeftParen) {
+                return parseCall(node.name);
+            }
+            return arena.add_expression(std::move(node));
         }
-        
+
+        case TokenType::LeftBracket:
+            return parseArrayLiteral();
+
         case TokenType::Quote: {
             advance(); // consume opening quote
             if (!hasTokens() || peekToken().type != TokenType::String) {
                 reportError("Expected string content after opening quote");
             }
-            std::string str_value = peekToken().value.value_or("");
+            Symbol str_value = intern(peekToken().value.value_or(""));
             advance(); // consume string content
             expectToken(TokenType::Quote, "Expected closing quote");
             return str_value;
         }
-        
+
         case TokenType::LeftParen: {
             advance(); // consume '('
-            // For now, just parse the first factor inside parentheses
-            auto result = parseFactor();
+            auto result = parseArithmeticExpression();
             expectToken(TokenType::RightParen, "after expression");
             return result;
         }
-        
+
         default:
-            reportError("Expected number, variable, or '(' in expression, but found " + 
-                       (token.value ? token.value.value() : "token"));
+            reportError("Expected number, variable, or '(' in expression, but found " +
+                       (token.value ? std::string(token.value.value()) : "token"));
+    }
+}
+
+// name[index], name[index].field or the slice name[start:end], after the
+// name
+Expression Parser::parseArrayAccess(Symbol array) {
+    advance(); // consume '['
+    ExprNode node;
+    node.kind = ExprKind::Index;
+    node.name = array;
+    node.left = parseArithmeticExpression();
+    if (hasTokens() && peekToken().type == TokenType::Colon) {
+        advance(); // consume ':'
+        node.kind = ExprKind::Slice;
+        node.right = parseArithmeticExpression();
+    }
+    expectToken(TokenType::RightBracket, node.kind == ExprKind::Slice ? "after slice bounds" : "after array index");
+    if (node.kind == ExprKind::Index && hasTokens() && peekToken().type == TokenType::Dot) {
+        node.kind = ExprKind::ElementField;
+        node.field = parseFieldName();
     }
+    return arena.add_expression(std::move(node));
 }
 
-// Parse a unary expression (for NOT operator)
-std::variant<UnaryExpression, Expression> Parser::parseUnaryExpression() {
+// name(arguments...), after the name
+Expression Parser::parseCall(Symbol function) {
+    advance(); // consume '('
+    std::vector<Expression> arguments;
+    while (hasTokens() && peekToken().type != TokenType::RightParen) {
+        arguments.push_back(parseArithmeticExpression());
+        if (hasTokens() && peekToken().type == TokenType::Comma) {
+            advance();
+        } else {
+            break;
+        }
+    }
+    expectToken(TokenType::RightParen, "to close the arguments of " + arena.symbols.name(function));
+
+    ExprNode node;
+    node.kind = ExprKind::Call;
+    node.name = function;
+    node.elements = arena.add_list(arguments);
+    return arena.add_expression(std::move(node));
+}
+
+// [a, b, c]
+Expression Parser::parseArrayLiteral() {
+    advance(); // consume '['
+    std::vector<Expression> elements;
+    while (hasTokens() && peekToken().type != TokenType::RightBracket) {
+        elements.push_back(parseArithmeticExpression());
+        if (hasTokens() && peekToken().type == TokenType::Comma) {
+            advance();
+        } else {
+            break;
+        }
+    }
+    expectToken(TokenType::RightBracket, "to close array literal");
+    if (elements.empty()) {
+        reportError("Array literal needs at least one element");
+    }
+
+    ExprNode node;
+    node.kind = ExprKind::ArrayLiteral;
+    node.elements = arena.add_list(elements);
+    return arena.add_expression(std::move(node));
+}
+
+// Parse a unary expression (!x, -x)
+Expression Parser::parseUnaryExpression() {
     if (hasTokens() && peekToken().type == TokenType::Not) {
         advance(); // consume '!'
-        auto operand = parseFactor();
-        UnaryExpression expr;
-        expr.operator_type = SigBinaryOperator::Not;
-        expr.operand = operand;
-        return expr;
+        ExprNode node;
+        node.kind = ExprKind::Unary;
+        node.op = SigBinaryOperator::Not;
+        node.left = parseUnaryExpression();
+        return arena.add_expression(std::move(node));
+    }
+
+    if (hasTokens() && peekToken().type == TokenType::Minus) {
+        advance(); // consume '-'
+        // A negated literal stays a literal
+        if (hasTokens() && peekToken().type == TokenType::IntegerLiteral) {
+            Expression value = integerLiteral(peekToken().value.value(), true);
+            advance();
+            return value;
+        }
+        if (hasTokens() && peekToken().type == TokenType::FloatLiteral) {
+            double value = -parseDouble(peekToken().value.value());
+            advance();
+            return value;
+        }
+        return makeBinary(SigBinaryOperator::Subtract, 0, parseUnaryExpression());
     }
-    
+
     return parseFactor();
 }
 
 // Parse arithmetic expressions (*, /, %)
 Expression Parser::parseArithmeticTerm() {
-    auto left = parseUnaryExpression();
-    
-    // Extract the actual value from the variant
-    Expression leftValue;
-    if (std::holds_alternative<UnaryExpression>(left)) {
-        // For now, return the unary expression as-is (this needs proper handling)
-        return std::get<UnaryExpression>(left).operand;
-    } else {
-        leftValue = std::get<Expression>(left);
-    }
-    
+    Expression left = parseUnaryExpression();
+
     while (hasTokens() && (peekToken().type == TokenType::Multiply ||
                           peekToken().type == TokenType::Divide ||
                           peekToken().type == TokenType::Modulo)) {
         TokenType op = peekToken().type;
         advance();
-        auto rightUnary = parseUnaryExpression();
-        
-        Expression rightValue;
-        if (std::holds_alternative<UnaryExpression>(rightUnary)) {
-            rightValue = std::get<UnaryExpression>(rightUnary).operand;
-        } else {
-            rightValue = std::get<Expression>(rightUnary);
-        }
-        
-        // Create a binary expression and evaluate it
-        BinaryExpression expr;
-        expr.left = leftValue;
-        expr.right = rightValue;
-        
+        Expression right = parseUnaryExpression();
+
         switch (op) {
             case TokenType::Multiply:
-                expr.operator_type = SigBinaryOperator::Multiply;
+                left = makeBinary(SigBinaryOperator::Multiply, left, right);
                 break;
             case TokenType::Divide:
-                expr.operator_type = SigBinaryOperator::Divide;
+                left = makeBinary(SigBinaryOperator::Divide, left, right);
                 break;
             case TokenType::Modulo:
-                expr.operator_type = SigBinaryOperator::Modulo;
+                left = makeBinary(SigBinaryOperator::Modulo, left, right);
                 break;
             default:
                 reportError("Unexpected operator in expression");
         }
-        
-        // For simplicity, return the expression (this needs proper evaluation)
-        leftValue = expr.left; // Placeholder
     }
-    
-    return leftValue;
+
+    return left;
 }
 
 // Parse additive expressions (+, -)
 Expression Parser::parseAdditiveExpression() {
-    auto left = parseArithmeticTerm();
-    
+    Expression left = parseArithmeticTerm();
+
     while (hasTokens() && (peekToken().type == TokenType::Plus ||
                           peekToken().type == TokenType::Minus)) {
         TokenType op = peekToken().type;
         advance();
-        auto right = parseArithmeticTerm();
-        
-        BinaryExpression expr;
-        expr.left = left;
-        expr.right = right;
-        
-        switch (op) {
-            case TokenType::Plus:
-                expr.operator_type = SigBinaryOperator::Add;
+        Expression right = parseArithmeticTerm();
+
+        left = makeBinary(op == TokenType::Plus ? SigBinaryOperator::Add : SigBinaryOperator::Subtract,
+                          left, right);
+    }
+
+    return left;
+}
+
+// Parse shift expressions (<<, >>)
+Expression Parser::parseShiftExpression() {
+    Expression left = parseAdditiveExpression();
+
+    while (hasTokens() && (peekToken().type == TokenType::LeftShift ||
+                          peekToken().type == TokenType::RightShift)) {
+        TokenType op = peekToken().type;
+        advance();
+        Expression right = parseAdditiveExpression();
+
+        left = makeBinary(op == TokenType::LeftShift ? SigBinaryOperator::LeftShift : SigBinaryOperator::RightShift,
+                          left, right);
+    }
+
+    return left;
+}
+
+// Parse relational expressions (<, <=, >, >=)
+Expression Parser::parseRelationalExpression() {
+    Expression left = parseShiftExpression();
+
+    while (hasTokens()) {
+        SigBinaryOperator op;
+        switch (peekToken().type) {
+            case TokenType::LessThan:
+                op = SigBinaryOperator::LessThan;
                 break;
-            case TokenType::Minus:
-                expr.operator_type = SigBinaryOperator::Subtract;
+            case TokenType::LessThanEqual:
+                op = SigBinaryOperator::LessThanEqual;
+                break;
+            case TokenType::GreaterThan:
+                op = SigBinaryOperator::GreaterThan;
+                break;
+            case TokenType::GreaterThanEqual:
+                op = SigBinaryOperator::GreaterThanEqual;
                 break;
             default:
-                reportError("Unexpected operator in expression");
+                return left;
         }
-        
-        // For now, we need to convert to a simple value rather than a complex expression
-        // This is a simplification - in a full implementation, we'd evaluate the expression
-        left = 0; // Placeholder - represents the result of the binary expression
+        advance();
+        left = makeBinary(op, left, parseShiftExpression());
     }
-    
+
     return left;
 }
 
-// Parse comparison expressions (==, !=, <, <=, >, >=)
-BinaryExpression Parser::parseComparisonExpression() {
-    auto left = parseAdditiveExpression();
-    
-    if (!hasTokens() || (peekToken().type != TokenType::EqualEqual &&
-                        peekToken().type != TokenType::NotEqual &&
-                        peekToken().type != TokenType::LessThan &&
-                        peekToken().type != TokenType::LessThanEqual &&
-                        peekToken().type != TokenType::GreaterThan &&
-                        peekToken().type != TokenType::GreaterThanEqual)) {
-        // No comparison operator, return dummy expression
-        BinaryExpression expr;
-        expr.left = left;
-        expr.operator_type = SigBinaryOperator::Add;
-        expr.right = 0;
-        return expr;
+// Parse equality expressions (==, !=)
+Expression Parser::parseComparisonExpression() {
+    Expression left = parseRelationalExpression();
+
+    while (hasTokens() && (peekToken().type == TokenType::EqualEqual ||
+                          peekToken().type == TokenType::NotEqual)) {
+        TokenType op = peekToken().type;
+        advance();
+        Expression right = parseRelationalExpression();
+
+        left = makeBinary(op == TokenType::EqualEqual ? SigBinaryOperator::Equal : SigBinaryOperator::NotEqual,
+                          left, right);
     }
-    
-    TokenType op = peekToken().type;
-    advance();
-    auto right = parseAdditiveExpression();
-    
-    BinaryExpression expr;
-    expr.left = left;
-    expr.right = right;
-    
-    switch (op) {
-        case TokenType::EqualEqual:
-            expr.operator_type = SigBinaryOperator::Equal;
-            break;
-        case TokenType::NotEqual:
-            expr.operator_type = SigBinaryOperator::NotEqual;
-            break;
-        case TokenType::LessThan:
-            expr.operator_type = SigBinaryOperator::LessThan;
-            break;
-        case TokenType::LessThanEqual:
-            expr.operator_type = SigBinaryOperator::LessThanEqual;
-            break;
-        case TokenType::GreaterThan:
-            expr.operator_type = SigBinaryOperator::GreaterThan;
-            break;
-        case TokenType::GreaterThanEqual:
-            expr.operator_type = SigBinaryOperator::GreaterThanEqual;
-            break;
-        default:
-            reportError("Unexpected comparison operator");
+
+    return left;
+}
+
+// Parse bitwise expressions; & binds tighter than ^, which binds tighter than |
+Expression Parser::parseBitwiseAndExpression() {
+    Expression left = parseComparisonExpression();
+
+    while (hasTokens() && peekToken().type == TokenType::BitwiseAnd) {
+        advance(); // consume '&'
+        left = makeBinary(SigBinaryOperator::BitwiseAnd, left, parseComparisonExpression());
+    }
+
+    return left;
+}
+
+Expression Parser::parseBitwiseXorExpression() {
+    Expression left = parseBitwiseAndExpression();
+
+    while (hasTokens() && peekToken().type == TokenType::BitwiseXor) {
+        advance(); // consume '^'
+        left = makeBinary(SigBinaryOperator::BitwiseXor, left, parseBitwiseAndExpression());
     }
-    
-    return expr;
+
+    return left;
+}
+
+Expression Parser::parseBitwiseOrExpression() {
+    Expression left = parseBitwiseXorExpression();
+
+    while (hasTokens() && peekToken().type == TokenType::BitwiseOr) {
+        advance(); // consume '|'
+        left = makeBinary(SigBinaryOperator::BitwiseOr, left, parseBitwiseXorExpression());
+    }
+
+    return left;
 }
 
 // Parse logical AND expressions
-BinaryExpression Parser::parseLogicalAndExpression() {
-    auto left = parseComparisonExpression();
-    
+Expression Parser::parseLogicalAndExpression() {
+    Expression left = parseBitwiseOrExpression();
+
     while (hasTokens() && peekToken().type == TokenType::And) {
         advance(); // consume '&&'
-        auto right = parseComparisonExpression();
-        
-        BinaryExpression expr;
-        expr.left = left.left; // Take left operand from comparison
-        expr.operator_type = SigBinaryOperator::And;
-        expr.right = right.left; // Take left operand from comparison
-        left = expr;
+        left = makeBinary(SigBinaryOperator::And, left, parseBitwiseOrExpression());
     }
-    
+
     return left;
 }
 
 // Parse logical OR expressions
-BinaryExpression Parser::parseLogicalOrExpression() {
-    auto left = parseLogicalAndExpression();
-    
+Expression Parser::parseLogicalOrExpression() {
+    Expression left = parseLogicalAndExpression();
+
     while (hasTokens() && peekToken().type == TokenType::Or) {
         advance(); // consume '||'
-        auto right = parseLogicalAndExpression();
-        
-        BinaryExpression expr;
-        expr.left = left.left; // Take left operand from comparison
-        expr.operator_type = SigBinaryOperator::Or;
-        expr.right = right.left; // Take left operand from comparison
-        left = expr;
+        left = makeBinary(SigBinaryOperator::Or, left, parseLogicalAndExpression());
     }
-    
+
     return left;
 }
 
 // Parse a full expression with proper precedence
-BinaryExpression Parser::parseArithmeticExpression() {
+Expression Parser::parseArithmeticExpression() {
     return parseLogicalOrExpression();
 }
 
-// Parse and add expression to AST as a statement
+// True if the next tokens are a single literal or variable name followed by
+// `terminator`, the forms statements store without an expression tree
+bool Parser::atSingleValue(TokenType terminator) const {
+    if (!hasTokens()) {
+        return false;
+    }
+    size_t length = 1;
+    switch (peekToken().type) {
+        case TokenType::Quote:
+            length = 3;
+            break;
+        case TokenType::IntegerLiteral:
+        case TokenType::HexLiteral:
+        case TokenType::FloatLiteral:
+        case TokenType::BooleanLiteral:
+        case TokenType::Identifier:
+        case TokenType::String:
+            break;
+        default:
+            return false;
+    }
+    return hasTokens(length + 1) && peekToken(length).type == terminator;
+}
+
+// Parse and add expression to AST as a statement. The result is unused, so
+// a lone literal produces no node.
 void Parser::parseExpression(AST& ast) {
-    auto expr = parseArithmeticExpression();
-    ast.emplace_back(expr);
+    Expression expr = parseArithmeticExpression();
+    auto* ref = std::get_if<ExprRef>(&expr);
+    if (!ref) {
+        return;
+    }
+    const ExprNode& node = arena.expression(*ref);
+    if (node.kind == ExprKind::Binary) {
+        ast.push_back(arena.add(BinaryExpression{node.left, node.op, node.right}));
+    } else if (node.kind == ExprKind::Unary) {
+        ast.push_back(arena.add(UnaryExpression{node.op, node.left}));
+    }
 }
@@ -14,12 +14,12 @@ void Parser::parseFunctionDefinition(AST& ast) {
         reportError("Expected function name after 'fn' keyword.\n"
                    " Example: fn myFunction() { return 0; }");
     }
-    const std::string functionName = peekToken().value.value_or("unnamed");
+    const Symbol functionName = intern(peekToken().value.value_or("unnamed"));
     advance();
     
     expectToken(TokenType::LeftParen, "expected '(' after function name");
     
-    std::vector<std::string> functionParams;
+    std::vector<TypedName> functionParams;
     
     if (hasTokens() && peekToken().type != TokenType::RightParen) {
         do {
@@ -28,10 +28,21 @@ void Parser::parseFunctionDefinition(AST& ast) {
                            " Example: fn myFunction(param1, param2) { ... }");
             }
             
-            std::string paramName = peekToken().value.value_or("unnamed_param");
-            functionParams.push_back(paramName);
+            TypedName param{intern(peekToken().value.value_or("unnamed_param"))};
             advance();
             
+            // name: type; a struct parameter is passed by pointer
+            if (hasTokens() && peekToken().type == TokenType::Colon) {
+                advance();
+                ArrayShape shape;
+                param.type = parseVariableType(shape);
+                param.record = shape.record;
+                if (param.type == SigType::Array || param.type == SigType::Slice) {
+                    reportError("Arrays and slices cannot be function parameters yet");
+                }
+            }
+            functionParams.push_back(param);
+            
             if (hasTokens() && peekToken().type == TokenType::Comma) {
                 advance();
                 if (!hasTokens() || peekToken().type == TokenType::RightParen) {
@@ -51,7 +62,7 @@ void Parser::parseFunctionDefinition(AST& ast) {
     
     expectToken(TokenType::RightBrace, "to close function body");
     
-    ast.emplace_back(FunctionDefinition{functionName, functionParams, std::move(functionBody)});
+    ast.push_back(arena.add(FunctionDefinition{functionName, arena.add_list(functionParams), arena.add_list(functionBody)}));
 }
 
 void Parser::parseFunctionCall(AST& ast) {
@@ -60,18 +71,18 @@ void Parser::parseFunctionCall(AST& ast) {
                    "   Example: myFunction();");
     }
 
-    const std::string functionName = peekToken().value.value_or("unnamed");
+    const std::string_view functionSpelling = peekToken().value.value_or("unnamed");
+    const Symbol functionName = intern(functionSpelling);
     advance();
 
-    expectToken(TokenType::LeftParen, "after function name. Example: " + functionName + "();");
+    expectToken(TokenType::LeftParen, "after function name. Example: " + std::string(functionSpelling) + "();");
     
     std::vector<Expression> arguments;
     
     // Parse arguments if they exist
     if (hasTokens() && peekToken().type != TokenType::RightParen) {
         do {
-            // Parse each argument as a factor (literal or identifier)
-            auto argument = parseFactor();
+            auto argument = parseArithmeticExpression();
             arguments.push_back(argument);
             
             // Check for comma indicating more arguments
@@ -90,5 +101,5 @@ void Parser::parseFunctionCall(AST& ast) {
     expectToken(TokenType::RightParen, "to close function call");
     expectToken(TokenType::Semicolon, "to end function call statement");
 
-    ast.emplace_back(FunctionCall{functionName, std::move(arguments)});
+    ast.push_back(arena.add(FunctionCall{functionName, arena.add_list(arguments)}));
 }
@@ -14,7 +14,11 @@ void Parser::parseReturnStatement(AST& ast) {
     } else {
         const auto& token = peekToken();
         if (token.value.has_value()) {
-            value = parseInteger(token.value.value());
+            uint64_t magnitude = parseInteger(token.value.value());
+            if (magnitude > INT32_MAX) {
+                reportError("Return value " + std::to_string(magnitude) + " is too large for i32");
+            }
+            value = static_cast<int>(magnitude);
         } else {
             reportError("Integer literal is missing its value. This appears to be a tokenizer issue.");
         }
@@ -28,7 +32,7 @@ void Parser::parseReturnStatement(AST& ast) {
         std::cerr << "All statements should end with a semicolon.\n\n";
     }
 
-    ast.emplace_back(ReturnStatement{value});
+    ast.push_back(arena.add(ReturnStatement{value}));
 }
 
 void Parser::parsePrintStatement(AST& ast) {
@@ -46,7 +50,15 @@ void Parser::parsePrintStatement(AST& ast) {
 
     const auto& token = peekToken();
 
-    if (token.type == TokenType::Quote) {
+    if ((!atSingleValue(TokenType::RightParen) || token.type == TokenType::HexLiteral ||
+         token.type == TokenType::IntegerLiteral) &&
+        token.type != TokenType::RightParen) {
+        Expression value = parseArithmeticExpression();
+        expectToken(TokenType::RightParen, "after expression to end print statement");
+        expectToken(TokenType::Semicolon, "to end print statement");
+        ast.push_back(arena.add(PrintStatement{value}));
+    }
+    else if (token.type == TokenType::Quote) {
         advance();
 
         if (!hasTokens() || peekToken().type != TokenType::String) {
@@ -56,34 +68,23 @@ void Parser::parsePrintStatement(AST& ast) {
 
         const auto& stringToken = peekToken();
         if (stringToken.value.has_value()) {
-            std::string stringValue = stringToken.value.value();
+            Symbol stringValue = intern(stringToken.value.value());
             advance();
             expectToken(TokenType::Quote, "after string content to close the string");
             expectToken(TokenType::RightParen, "after closing quote to end print statement");
             expectToken(TokenType::Semicolon, "to end print statement");
-            ast.emplace_back(PrintStatement{stringValue});
+            ast.push_back(arena.add(PrintStatement{stringValue}));
         } else {
             reportError("String literal is missing its value. This appears to be a tokenizer issue.");
         }
     }
-    else if (token.type == TokenType::IntegerLiteral) {
-        if (token.value.has_value()) {
-            int value = parseInteger(token.value.value());
-            advance();
-            expectToken(TokenType::RightParen, "after integer to end print statement");
-            expectToken(TokenType::Semicolon, "to end print statement");
-            ast.emplace_back(PrintStatement{value});
-        } else {
-            reportError("Integer literal is missing its value. This appears to be a tokenizer issue.");
-        }
-    }
     else if (token.type == TokenType::FloatLiteral) {
         if (token.value.has_value()) {
             double value = parseDouble(token.value.value());
             advance();
             expectToken(TokenType::RightParen, "after float to end print statement");
             expectToken(TokenType::Semicolon, "to end print statement");
-            ast.emplace_back(PrintStatement{value});
+            ast.push_back(arena.add(PrintStatement{value}));
         } else {
             reportError("Float literal is missing its value. This appears to be a tokenizer issue.");
         }
@@ -94,18 +95,18 @@ void Parser::parsePrintStatement(AST& ast) {
             advance();
             expectToken(TokenType::RightParen, "after boolean to end print statement");
             expectToken(TokenType::Semicolon, "to end print statement");
-            ast.emplace_back(PrintStatement{value});
+            ast.push_back(arena.add(PrintStatement{value}));
         } else {
             reportError("Boolean literal is missing its value. This appears to be a tokenizer issue.");
         }
     }
     else if (token.type == TokenType::Identifier) {
         if (token.value.has_value()) {
-            std::string variableName = token.value.value();
+            Symbol variableName = intern(token.value.value());
             advance();
             expectToken(TokenType::RightParen, "after variable name to end print statement");
             expectToken(TokenType::Semicolon, "to end print statement");
-            ast.emplace_back(PrintVariable{variableName});
+            ast.push_back(arena.add(PrintVariable{variableName}));
         } else {
             reportError("Variable name is missing its value. This appears to be a tokenizer issue.");
         }
@@ -135,7 +136,15 @@ void Parser::parsePrintlnStatement(AST& ast) {
 
     const auto& token = peekToken();
 
-    if (token.type == TokenType::Quote) {
+    if ((!atSingleValue(TokenType::RightParen) || token.type == TokenType::HexLiteral ||
+         token.type == TokenType::IntegerLiteral) &&
+        token.type != TokenType::RightParen) {
+        Expression value = parseArithmeticExpression();
+        expectToken(TokenType::RightParen, "after expression to end println statement");
+        expectToken(TokenType::Semicolon, "to end println statement");
+        ast.push_back(arena.add(PrintlnStatement{value}));
+    }
+    else if (token.type == TokenType::Quote) {
         advance();
 
         if (!hasTokens() || peekToken().type != TokenType::String) {
@@ -145,34 +154,23 @@ void Parser::parsePrintlnStatement(AST& ast) {
 
         const auto& stringToken = peekToken();
         if (stringToken.value.has_value()) {
-            std::string stringValue = stringToken.value.value();
+            Symbol stringValue = intern(stringToken.value.value());
             advance();
             expectToken(TokenType::Quote, "after string content to close the string");
             expectToken(TokenType::RightParen, "after closing quote to end println statement");
             expectToken(TokenType::Semicolon, "to end println statement");
-            ast.emplace_back(PrintlnStatement{stringValue});
+            ast.push_back(arena.add(PrintlnStatement{stringValue}));
         } else {
             reportError("String literal is missing its value. This appears to be a tokenizer issue.");
         }
     }
-    else if (token.type == TokenType::IntegerLiteral) {
-        if (token.value.has_value()) {
-            int value = parseInteger(token.value.value());
-            advance();
-            expectToken(TokenType::RightParen, "after integer to end println statement");
-            expectToken(TokenType::Semicolon, "to end println statement");
-            ast.emplace_back(PrintlnStatement{value});
-        } else {
-            reportError("Integer literal is missing its value. This appears to be a tokenizer issue.");
-        }
-    }
     else if (token.type == TokenType::FloatLiteral) {
         if (token.value.has_value()) {
             double value = parseDouble(token.value.value());
             advance();
             expectToken(TokenType::RightParen, "after float to end println statement");
             expectToken(TokenType::Semicolon, "to end println statement");
-            ast.emplace_back(PrintlnStatement{value});
+            ast.push_back(arena.add(PrintlnStatement{value}));
         } else {
             reportError("Float literal is missing its value. This appears to be a tokenizer issue.");
         }
@@ -183,18 +181,18 @@ void Parser::parsePrintlnStatement(AST& ast) {
             advance();
             expectToken(TokenType::RightParen, "after boolean to end println statement");
             expectToken(TokenType::Semicolon, "to end println statement");
-            ast.emplace_back(PrintlnStatement{value});
+            ast.push_back(arena.add(PrintlnStatement{value}));
         } else {
             reportError("Boolean literal is missing its value. This appears to be a tokenizer issue.");
         }
     }
     else if (token.type == TokenType::Identifier) {
         if (token.value.has_value()) {
-            std::string variableName = token.value.value();
+            Symbol variableName = intern(token.value.value());
             advance();
             expectToken(TokenType::RightParen, "after variable name to end println statement");
             expectToken(TokenType::Semicolon, "to end println statement");
-            ast.emplace_back(PrintVariable{variableName});
+            ast.push_back(arena.add(PrintVariable{variableName}));
         } else {
             reportError("Variable name is missing its value. This appears to be a tokenizer issue.");
         }
@@ -223,12 +221,12 @@ void Parser::parseAsmStatement(AST& ast) {
     const auto& token = peekToken();
     if (token.type == TokenType::String) {
         if (token.value.has_value()) {
-            std::string stringValue = token.value.value();
+            Symbol stringValue = intern(token.value.value());
             advance();
             expectToken(TokenType::Quote, "to close assembly string");
             expectToken(TokenType::RightParen, "to close asm statement");
             expectToken(TokenType::Semicolon, "to end asm statement");
-            ast.emplace_back(AsmStatement{stringValue});
+            ast.push_back(arena.add(AsmStatement{stringValue}));
         } else {
             reportError("Assembly string is missing its value. This appears to be a tokenizer issue.");
         }
@@ -246,15 +244,49 @@ void Parser::parseVariables(AST& ast) {
                    "   • let name = \"John\";");
     }
 
-    const std::string variableName = peekToken().value.value_or("unnamed");
+    const Symbol variableName = intern(peekToken().value.value_or("unnamed"));
     advance();
 
+    // let name[index] = value; or let name[index].field = value;
+    if (hasTokens() && peekToken().type == TokenType::LeftBracket) {
+        advance(); // consume '['
+        Expression index = parseArithmeticExpression();
+        expectToken(TokenType::RightBracket, "after array index");
+        if (hasTokens() && peekToken().type == TokenType::Dot) {
+            Symbol field = parseFieldName();
+            expectToken(TokenType::Equal, "in field assignment");
+            Expression value = parseArithmeticExpression();
+            expectToken(TokenType::Semicolon, "to end field assignment");
+            ast.push_back(arena.add(FieldAssignment{variableName, index, field, value}));
+            return;
+        }
+        expectToken(TokenType::Equal, "in element assignment");
+        Expression value = parseArithmeticExpression();
+        expectToken(TokenType::Semicolon, "to end element assignment");
+        ast.push_back(arena.add(IndexAssignment{variableName, index, value}));
+        return;
+    }
+
+    // let name.field = value;
+    if (hasTokens() && peekToken().type == TokenType::Dot) {
+        Symbol field = parseFieldName();
+        expectToken(TokenType::Equal, "in field assignment");
+        Expression value = parseArithmeticExpression();
+        expectToken(TokenType::Semicolon, "to end field assignment");
+        ast.push_back(arena.add(FieldAssignment{variableName, std::nullopt, field, value}));
+        return;
+    }
+
     // Check for optional type annotation
     std::optional<SigType> typeAnnotation;
+    ArrayShape arrayShape;
     if (hasTokens() && peekToken().type == TokenType::Colon) {
         advance(); // Skip colon
-        typeAnnotation = parseTypeAnnotation();
+        typeAnnotation = parseVariableType(arrayShape);
     }
+    // Arrays and structs are only assigned from expressions
+    bool isAggregate = typeAnnotation == SigType::Array || typeAnnotation == SigType::Slice ||
+                       typeAnnotation == SigType::Struct;
 
     if (hasTokens() && peekToken().type == TokenType::Equal) {
         advance();
@@ -268,7 +300,12 @@ void Parser::parseVariables(AST& ast) {
 
         const auto& valueToken = peekToken();
 
-        if (valueToken.type == TokenType::HexLiteral) {
+        if (!atSingleValue(TokenType::Semicolon) || valueToken.type == TokenType::Identifier || isAggregate) {
+            Expression value = parseArithmeticExpression();
+            expectToken(TokenType::Semicolon, "to end variable assignment");
+            ast.push_back(arena.add(VariableAssignment{variableName, value, typeAnnotation, arrayShape}));
+        }
+        else if (valueToken.type == TokenType::HexLiteral) {
             if (valueToken.value.has_value()) {
                 uint64_t value = parseHexLiteral(valueToken.value.value());
                 advance();
@@ -276,11 +313,11 @@ void Parser::parseVariables(AST& ast) {
 
                 if (typeAnnotation.has_value()) {
                     TypedValue typedValue = createTypedValue(typeAnnotation.value(), value);
-                    ast.emplace_back(VariableAssignment{variableName, typedValue, typeAnnotation});
+                    ast.push_back(arena.add(VariableAssignment{variableName, typedValue, typeAnnotation}));
                 } else {
                     // Default to u32 for hex literals without explicit type
                     TypedValue typedValue = createTypedValue(SigType::U32, value);
-                    ast.emplace_back(VariableAssignment{variableName, typedValue, SigType::U32});
+                    ast.push_back(arena.add(VariableAssignment{variableName, typedValue, SigType::U32}));
                 }
             } else {
                 reportError("Hex literal is missing its value. This appears to be a tokenizer issue.");
@@ -288,15 +325,15 @@ void Parser::parseVariables(AST& ast) {
         }
         else if (valueToken.type == TokenType::IntegerLiteral) {
             if (valueToken.value.has_value()) {
-                int value = parseInteger(valueToken.value.value());
+                std::string_view digits = valueToken.value.value();
                 advance();
                 expectToken(TokenType::Semicolon, "to end variable assignment");
 
                 if (typeAnnotation.has_value()) {
-                    TypedValue typedValue = createTypedValue(typeAnnotation.value(), static_cast<uint64_t>(value));
-                    ast.emplace_back(VariableAssignment{variableName, typedValue, typeAnnotation});
+                    TypedValue typedValue = createTypedValue(typeAnnotation.value(), parseInteger(digits));
+                    ast.push_back(arena.add(VariableAssignment{variableName, typedValue, typeAnnotation}));
                 } else {
-                    ast.emplace_back(VariableAssignment{variableName, value, std::nullopt});
+                    ast.push_back(arena.add(VariableAssignment{variableName, integerLiteral(digits, false), std::nullopt}));
                 }
             } else {
                 reportError("Integer literal is missing its value. This appears to be a tokenizer issue.");
@@ -308,7 +345,7 @@ void Parser::parseVariables(AST& ast) {
                 advance();
                 expectToken(TokenType::Semicolon, "to end variable assignment");
 
-                ast.emplace_back(VariableAssignment{variableName, value, std::nullopt});
+                ast.push_back(arena.add(VariableAssignment{variableName, value, std::nullopt}));
             } else {
                 reportError("Float literal is missing its value. This appears to be a tokenizer issue.");
             }
@@ -319,7 +356,7 @@ void Parser::parseVariables(AST& ast) {
                 advance();
                 expectToken(TokenType::Semicolon, "to end variable assignment");
 
-                ast.emplace_back(VariableAssignment{variableName, value, std::nullopt});
+                ast.push_back(arena.add(VariableAssignment{variableName, value, std::nullopt}));
             } else {
                 reportError("Boolean literal is missing its value. This appears to be a tokenizer issue.");
             }
@@ -334,23 +371,23 @@ void Parser::parseVariables(AST& ast) {
 
             const auto& stringToken = peekToken();
             if (stringToken.value.has_value()) {
-                std::string stringValue = stringToken.value.value();
+                Symbol stringValue = intern(stringToken.value.value());
                 advance();
                 expectToken(TokenType::Quote, "to close string in variable assignment");
                 expectToken(TokenType::Semicolon, "to end variable assignment");
 
-                ast.emplace_back(VariableAssignment{variableName, stringValue});
+                ast.push_back(arena.add(VariableAssignment{variableName, stringValue}));
             } else {
                 reportError("String literal is missing its value. This appears to be a tokenizer issue.");
             }
         }
         else if (valueToken.type == TokenType::String) {
             if (valueToken.value.has_value()) {
-                std::string stringValue = valueToken.value.value();
+                Symbol stringValue = intern(valueToken.value.value());
                 advance();
                 expectToken(TokenType::Semicolon, "to end variable assignment");
 
-                ast.emplace_back(VariableAssignment{variableName, stringValue});
+                ast.push_back(arena.add(VariableAssignment{variableName, stringValue}));
             } else {
                 reportError("String literal is missing its value. This appears to be a tokenizer issue.");
             }
@@ -365,7 +402,7 @@ void Parser::parseVariables(AST& ast) {
     } else {
         expectToken(TokenType::Semicolon, "to end variable declaration");
 
-        ast.emplace_back(VariableDeclaration{variableName, typeAnnotation});
+        ast.push_back(arena.add(VariableDeclaration{variableName, typeAnnotation, arrayShape}));
     }
 }
 
@@ -382,7 +419,7 @@ void Parser::parseModStatement(AST& ast) {
 
         const auto& stringToken = peekToken();
         if (stringToken.value.has_value()) {
-            std::string moduleFile = stringToken.value.value();
+            std::string moduleFile(stringToken.value.value());
             advance();
             expectToken(TokenType::Quote, "to close module filename");
             expectToken(TokenType::Semicolon, "to end module statement");
@@ -391,7 +428,7 @@ void Parser::parseModStatement(AST& ast) {
             std::filesystem::path moduleDir = currentFile.parent_path();
             std::filesystem::path fullModulePath = moduleDir / moduleFile;
             
-            ast.emplace_back(ModStatement{fullModulePath.string()});
+            ast.push_back(arena.add(ModStatement{intern(fullModulePath.string())}));
 
             if (std::filesystem::exists(fullModulePath)) {
                 // Module exists, good
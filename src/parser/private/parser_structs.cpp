@@ -1,160 +1,125 @@
 #include "parser_base.hpp"
-#include <iostream>
+#include <string>
 
+// struct Name { field: type, ... } with the optional layout attributes
+// `packed` and `align(N)` between the name and the brace
 void Parser::parseStructDefinition(AST& ast) {
-    // Skip 'struct' keyword
-    advance();
-    
-    // Get struct name
+    advance(); // consume 'struct'
+
     if (!hasTokens() || peekToken().type != TokenType::Identifier) {
-        reportError("Expected struct name after 'struct' keyword");
+        reportError("Expected struct name after 'struct' keyword.\n"
+                   "   Example: struct Point { x: i32, y: i32 }");
     }
-    
-    std::string structName = peekToken().value.value_or("");
+    StructDefinition definition;
+    definition.name = intern(peekToken().value.value());
     advance();
-    
-    // Expect opening brace
+
+    // `packed` and `align` are only keywords here
+    while (hasTokens() && peekToken().type == TokenType::Identifier) {
+        std::string_view attribute = peekToken().value.value();
+        if (attribute == "packed") {
+            advance();
+            definition.packed = true;
+        } else if (attribute == "align") {
+            advance();
+            expectToken(TokenType::LeftParen, "after 'align'. Example: align(16)");
+            if (!hasTokens() || peekToken().type != TokenType::IntegerLiteral) {
+                reportError("Expected an alignment in bytes inside align(...)");
+            }
+            uint64_t alignment = parseInteger(peekToken().value.value());
+            if (alignment == 0 || alignment > 4096 || (alignment & (alignment - 1)) != 0) {
+                reportError("Struct alignment must be a power of two from 1 to 4096, got " + std::to_string(alignment));
+            }
+            definition.align = static_cast<uint32_t>(alignment);
+            advance();
+            expectToken(TokenType::RightParen, "after struct alignment");
+        } else {
+            reportError("Unknown struct attribute '" + std::string(attribute) + "'. Expected 'packed' or 'align(N)'");
+        }
+    }
+
     expectToken(TokenType::LeftBrace, "after struct name");
-    
-    std::vector<StructField> fields;
-    
-    // Parse fields
+
+    std::vector<TypedName> fields;
+    skipComments();
     while (hasTokens() && peekToken().type != TokenType::RightBrace) {
-        // Parse field name
         if (peekToken().type != TokenType::Identifier) {
             reportError("Expected field name in struct definition");
         }
-        
-        std::string fieldName = peekToken().value.value_or("");
+        Symbol field = intern(peekToken().value.value());
         advance();
-        
-        // Expect colon
         expectToken(TokenType::Colon, "after field name");
-        
-        // Parse field type
-        SigType fieldType;
-        std::optional<std::string> structTypeName;
-        
-        const auto& typeToken = peekToken();
-        advance();
-        
-        switch (typeToken.type) {
-            case TokenType::U8: fieldType = SigType::U8; break;
-            case TokenType::U16: fieldType = SigType::U16; break;
-            case TokenType::U32: fieldType = SigType::U32; break;
-            case TokenType::U64: fieldType = SigType::U64; break;
-            case TokenType::I8: fieldType = SigType::I8; break;
-            case TokenType::I16: fieldType = SigType::I16; break;
-            case TokenType::I32: fieldType = SigType::I32; break;
-            case TokenType::I64: fieldType = SigType::I64; break;
-            case TokenType::Identifier:
-                // This could be another struct type
-                fieldType = SigType::Struct;
-                structTypeName = typeToken.value.value_or("");
-                break;
-            default:
-                reportError("Invalid field type. Expected u8, u16, u32, u64, i8, i16, i32, i64, or struct name");
-        }
-        
-        fields.push_back(StructField{fieldName, fieldType, structTypeName});
-        
-        // Expect comma or closing brace
+        fields.push_back(TypedName{field, parseTypeAnnotation()});
+        skipComments();
+
         if (hasTokens() && peekToken().type == TokenType::Comma) {
             advance();
+            skipComments();
         } else if (hasTokens() && peekToken().type != TokenType::RightBrace) {
             reportError("Expected ',' between struct fields or '}' to end struct definition");
         }
     }
-    
-    // Expect closing brace
     expectToken(TokenType::RightBrace, "to close struct definition");
-    
-    // Create struct definition
-    StructDefinition structDef{structName, fields};
-    ast.push_back(structDef);
-}
-
-StructAccess Parser::parseStructAccess() {
-    // Parse struct_name.field_name
-    if (!hasTokens() || peekToken().type != TokenType::Identifier) {
-        reportError("Expected struct variable name for member access");
-    }
-    
-    std::string structName = peekToken().value.value_or("");
-    advance();
-    
-    expectToken(TokenType::Dot, "for member access");
-    
-    if (!hasTokens() || peekToken().type != TokenType::Identifier) {
-        reportError("Expected field name after '.'");
+    if (fields.empty()) {
+        reportError("Struct '" + std::string(arena.symbols.name(definition.name)) + "' needs at least one field");
     }
-    
-    std::string fieldName = peekToken().value.value_or("");
-    advance();
-    
-    return StructAccess{structName, fieldName};
+
+    definition.fields = arena.add_list(fields);
+    ast.push_back(arena.add(definition));
 }
 
-StructInitialization Parser::parseStructInitialization() {
-    // Parse StructType { field1: value1, field2: value2 }
-    if (!hasTokens() || peekToken().type != TokenType::Identifier) {
-        reportError("Expected struct type name for initialization");
-    }
-    
-    std::string structType = peekToken().value.value_or("");
-    advance();
-    
-    expectToken(TokenType::LeftBrace, "for struct initialization");
-    
-    std::vector<StructInitField> fields;
-    
+// Name { field: value, ... } after the name; fields left out are zero
+Expression Parser::parseStructLiteral(Symbol record) {
+    advance(); // consume '{'
+    std::vector<Symbol> fields;
+    std::vector<Expression> values;
     while (hasTokens() && peekToken().type != TokenType::RightBrace) {
-        // Parse field name
         if (peekToken().type != TokenType::Identifier) {
-            reportError("Expected field name in struct initialization");
+            reportError("Expected field name in struct literal");
         }
-        
-        std::string fieldName = peekToken().value.value_or("");
+        fields.push_back(intern(peekToken().value.value()));
         advance();
-        
-        expectToken(TokenType::Colon, "after field name in struct initialization");
-        
-        // Parse field value - for now, just support simple literals
-        Expression value;
-        const auto& valueToken = peekToken();
-        advance();
-        
-        switch (valueToken.type) {
-            case TokenType::IntegerLiteral:
-                value = parseInteger(valueToken.value.value_or("0"));
-                break;
-            case TokenType::FloatLiteral:
-                value = parseDouble(valueToken.value.value_or("0.0"));
-                break;
-            case TokenType::BooleanLiteral:
-                value = (valueToken.value.value_or("false") == "true");
-                break;
-            case TokenType::String:
-                value = valueToken.value.value_or("");
-                break;
-            case TokenType::HexLiteral:
-                value = static_cast<int>(parseHexLiteral(valueToken.value.value_or("0x0")));
-                break;
-            default:
-                reportError("Unsupported value type in struct initialization");
-        }
-        
-        fields.push_back(StructInitField{fieldName, value});
-        
-        // Expect comma or closing brace
+        expectToken(TokenType::Colon, "after field name in struct literal");
+        values.push_back(parseArithmeticExpression());
+
         if (hasTokens() && peekToken().type == TokenType::Comma) {
             advance();
         } else if (hasTokens() && peekToken().type != TokenType::RightBrace) {
-            reportError("Expected ',' between struct fields or '}' to end struct initialization");
+            reportError("Expected ',' between struct fields or '}' to end struct literal");
+        }
+    }
+    expectToken(TokenType::RightBrace, "to close struct literal");
+
+    ExprNode node;
+    node.kind = ExprKind::StructLiteral;
+    node.name = record;
+    node.elements = arena.add_list(values);
+    node.fields = arena.add_list(fields);
+    return arena.add_expression(std::move(node));
+}
+
+// The field name after '.'
+Symbol Parser::parseFieldName() {
+    advance(); // consume '.'
+    if (!hasTokens() || peekToken().type != TokenType::Identifier) {
+        reportError("Expected field name after '.'");
+    }
+    Symbol field = intern(peekToken().value.value());
+    advance();
+    return field;
+}
+
+// Comments between struct fields, which are otherwise only skipped between
+// statements
+void Parser::skipComments() {
+    while (hasTokens()) {
+        if (peekToken().type == TokenType::Comment) {
+            advance();
+        } else if (peekToken().type == TokenType::MultilineComment) {
+            AST unused;
+            parseMultiComment(unused);
+        } else {
+            break;
         }
     }
-    
-    expectToken(TokenType::RightBrace, "to close struct initialization");
-    
-    return StructInitialization{structType, fields};
 }
@@ -2,4 +2,26 @@
 #include <lexer/public/lexer.hpp>
 #include <ast/public/ast_simple.hpp>
 
-AST parse(const std::vector<Token>& tokens, const std::string& file_path = "");
+#include <cstdint>
+#include <stdexcept>
+
+// Nodes are allocated in `arena`; the returned AST lists the top-level ones
+AST parse(const std::vector<Token>& tokens, AstArena& arena, const std::string& file_path = "");
+
+// Thrown instead of exiting by parse_top_level()
+struct ParseError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Where a top-level statement starts and how many AST nodes it produced
+// (comments produce none)
+struct StatementSpan {
+    uint32_t offset;
+    size_t node_count;
+};
+
+// Like parse(), but throws ParseError instead of exiting and records the
+// span of every top-level statement. Used by the incremental front end and
+// by module loading on worker threads.
+AST parse_top_level(const std::vector<Token>& tokens, AstArena& arena, const std::string& file_path,
+                    std::vector<StatementSpan>& spans);
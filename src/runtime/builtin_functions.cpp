@@ -1,16 +1,17 @@
-#include <iostream>
-#include <string>
+// Only the C library here: programs link this as a static archive
+// without libstdc++
+#include "output.hpp"
 #include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <cstdlib>
 
 extern "C" {
     // input(prompt) - reads a line from stdin, prints prompt first
     char* sig_input(const char* prompt) {
-        if (prompt) {
-            printf("%s", prompt);
-            fflush(stdout);
-        }
+        // Also pushes out anything printed before the prompt
+        sig_write_str(prompt);
+        sig_flush();
         
         char* buffer = (char*)malloc(1024);
         if (!buffer) {
@@ -51,13 +52,13 @@ extern "C" {
         return sqrt(x);
     }
     
-    // max(a, b) - maximum of two numbers
+    // max(a, b) - maximum of two numbers; a NaN argument yields the other
     double sig_max(double a, double b) {
-        return (a > b) ? a : b;
+        return fmax(a, b);
     }
     
-    // min(a, b) - minimum of two numbers
+    // min(a, b) - minimum of two numbers; a NaN argument yields the other
     double sig_min(double a, double b) {
-        return (a < b) ? a : b;
+        return fmin(a, b);
     }
 }
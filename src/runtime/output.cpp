@@ -0,0 +1,211 @@
+// Only the C library here: programs link this as a static archive
+// without libstdc++
+#include "output.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t buffer_size = 64 * 1024;
+
+// Zero-initialized and trivially destructible, so thread_local needs no
+// C++ runtime support
+struct OutputBuffer {
+    size_t used;
+    bool registered;
+    bool line_buffered;
+    char data[buffer_size];
+};
+
+thread_local OutputBuffer output;
+
+pthread_key_t flush_key;
+pthread_once_t flush_once = PTHREAD_ONCE_INIT;
+
+// "00" .. "99", so integers convert two digits per division
+constexpr char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+void write_all(const char* data, size_t size, int fd = STDOUT_FILENO) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+void flush_buffer(OutputBuffer& buffer) {
+    write_all(buffer.data, buffer.used);
+    buffer.used = 0;
+}
+
+// Key destructors run for threads that exit; the exit-time destructor
+// below covers the thread that calls exit(), which is usually main
+void flush_at_thread_exit(void* buffer) {
+    flush_buffer(*static_cast<OutputBuffer*>(buffer));
+}
+
+// A .fini_array entry rather than atexit(): glibc's atexit needs
+// __dso_handle from crtbegin.o, which executables are linked without
+__attribute__((destructor)) void flush_at_exit() {
+    sig_flush();
+}
+
+void create_flush_key() {
+    pthread_key_create(&flush_key, flush_at_thread_exit);
+}
+
+OutputBuffer& buffer_with_room(size_t size) {
+    OutputBuffer& buffer = output;
+    if (!buffer.registered) {
+        buffer.registered = true;
+        buffer.line_buffered = isatty(STDOUT_FILENO);
+        pthread_once(&flush_once, create_flush_key);
+        pthread_setspecific(flush_key, &buffer);
+    }
+    if (buffer.used + size > buffer_size) {
+        flush_buffer(buffer);
+    }
+    return buffer;
+}
+
+void append(const char* data, size_t size) {
+    if (size > buffer_size) {
+        flush_buffer(buffer_with_room(0));
+        write_all(data, size);
+        return;
+    }
+    OutputBuffer& buffer = buffer_with_room(size);
+    memcpy(buffer.data + buffer.used, data, size);
+    buffer.used += size;
+}
+
+// Writes `value` in decimal ending just before `end`; returns the start
+char* format_unsigned(uint64_t value, char* end) {
+    while (value >= 100) {
+        unsigned pair = static_cast<unsigned>(value % 100) * 2;
+        value /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = static_cast<unsigned>(value) * 2;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    } else {
+        *--end = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+}  // namespace
+
+extern "C" {
+    void sig_write_i64(int64_t value) {
+        char text[24];
+        char* end = text + sizeof(text);
+        uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        char* start = format_unsigned(magnitude, end);
+        if (value < 0) {
+            *--start = '-';
+        }
+        append(start, static_cast<size_t>(end - start));
+    }
+
+    void sig_write_u64(uint64_t value) {
+        char text[24];
+        char* end = text + sizeof(text);
+        char* start = format_unsigned(value, end);
+        append(start, static_cast<size_t>(end - start));
+    }
+
+    void sig_write_i32(int32_t value) {
+        sig_write_i64(value);
+    }
+
+    void sig_write_f64(double value) {
+        // Whole numbers, the common case, skip printf's general conversion
+        if (std::fabs(value) < 1e15 && value == std::trunc(value)) {
+            char text[32];
+            char* end = text + sizeof(text) - 7;
+            memcpy(end, ".000000", 7);
+            char* start = format_unsigned(static_cast<uint64_t>(std::fabs(value)), end);
+            if (std::signbit(value)) {
+                *--start = '-';
+            }
+            append(start, static_cast<size_t>(text + sizeof(text) - start));
+            return;
+        }
+
+        // %f of the largest double is 317 characters
+        OutputBuffer& buffer = buffer_with_room(320);
+        int written = snprintf(buffer.data + buffer.used, 320, "%f", value);
+        if (written > 0) {
+            buffer.used += static_cast<size_t>(written);
+        }
+    }
+
+    void sig_write_bool(int32_t value) {
+        if (value) {
+            append("true", 4);
+        } else {
+            append("false", 5);
+        }
+    }
+
+    void sig_write_str(const char* value) {
+        if (value) {
+            append(value, strlen(value));
+        }
+    }
+
+    void sig_write_newline(void) {
+        OutputBuffer& buffer = buffer_with_room(1);
+        buffer.data[buffer.used++] = '\n';
+        if (buffer.line_buffered) {
+            flush_buffer(buffer);
+        }
+    }
+
+    void sig_flush(void) {
+        OutputBuffer& buffer = output;
+        if (buffer.used > 0) {
+            flush_buffer(buffer);
+        }
+    }
+
+    void sig_index_out_of_bounds(int64_t index, int64_t length) {
+        sig_flush();
+
+        char text[96];
+        char* end = text + sizeof(text);
+        *--end = '\n';
+        end = format_unsigned(static_cast<uint64_t>(length), end);
+        const char middle[] = " out of bounds for length ";
+        end -= sizeof(middle) - 1;
+        memcpy(end, middle, sizeof(middle) - 1);
+        uint64_t magnitude = index < 0 ? 0 - static_cast<uint64_t>(index) : static_cast<uint64_t>(index);
+        end = format_unsigned(magnitude, end);
+        if (index < 0) {
+            *--end = '-';
+        }
+        const char prefix[] = "Error: index ";
+        end -= sizeof(prefix) - 1;
+        memcpy(end, prefix, sizeof(prefix) - 1);
+        write_all(end, static_cast<size_t>(text + sizeof(text) - end), STDERR_FILENO);
+        exit(1);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+// Buffered standard output for compiled programs; print and println lower
+// to these. Output is held in a per-thread buffer and written to fd 1 when
+// the buffer fills, on sig_flush(), at thread exit and at process exit. On
+// a terminal every newline also flushes.
+extern "C" {
+    void sig_write_i32(int32_t value);
+    void sig_write_i64(int64_t value);
+    void sig_write_u64(uint64_t value);
+    void sig_write_f64(double value);      // like printf("%f")
+    void sig_write_bool(int32_t value);    // "true" or "false"
+    void sig_write_str(const char* value); // null prints nothing
+    void sig_write_newline(void);
+    void sig_flush(void);
+
+    // Failed array bounds check: flushes output, reports the index to
+    // stderr and exits with status 1
+    [[noreturn]] void sig_index_out_of_bounds(int64_t index, int64_t length);
+}
@@ -0,0 +1,991 @@
+#include "../public/type_inference.hpp"
+#include <ast/public/scoped_table.hpp>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+bool is_integer_type(SigType type) {
+    switch (type) {
+        case SigType::Untyped:
+        case SigType::U8: case SigType::U16: case SigType::U32: case SigType::U64:
+        case SigType::I8: case SigType::I16: case SigType::I32: case SigType::I64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_signed_type(SigType type) {
+    switch (type) {
+        case SigType::Untyped:
+        case SigType::I8: case SigType::I16: case SigType::I32: case SigType::I64:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool is_array_type(SigType type) {
+    return type == SigType::Array || type == SigType::Slice;
+}
+
+unsigned type_bits(SigType type) {
+    switch (type) {
+        case SigType::Bool: return 1;
+        case SigType::U8: case SigType::I8: return 8;
+        case SigType::U16: case SigType::I16: return 16;
+        case SigType::U64: case SigType::I64: case SigType::Float: return 64;
+        default: return 32;
+    }
+}
+
+const char* type_name(SigType type) {
+    switch (type) {
+        case SigType::U8: return "u8";
+        case SigType::U16: return "u16";
+        case SigType::U32: return "u32";
+        case SigType::U64: return "u64";
+        case SigType::I8: return "i8";
+        case SigType::I16: return "i16";
+        case SigType::Untyped:
+        case SigType::I32: return "i32";
+        case SigType::I64: return "i64";
+        case SigType::Bool: return "bool";
+        case SigType::Float: return "f64";
+        case SigType::String: return "string";
+        case SigType::Pointer: return "pointer";
+        case SigType::Array: return "array";
+        case SigType::Slice: return "slice";
+        case SigType::Struct: return "struct";
+    }
+    return "unknown";
+}
+
+SigType expression_type(const AstArena& arena, const Expression& expr) {
+    return std::visit([&](const auto& e) -> SigType {
+        using T = std::decay_t<decltype(e)>;
+        if constexpr (std::is_same_v<T, int>) {
+            return SigType::I32;
+        } else if constexpr (std::is_same_v<T, double>) {
+            return SigType::Float;
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return SigType::Bool;
+        } else if constexpr (std::is_same_v<T, Symbol>) {
+            return SigType::String;
+        } else if constexpr (std::is_same_v<T, TypedValue>) {
+            return e.type == SigType::Untyped ? SigType::I32 : e.type;
+        } else {
+            SigType type = arena.expression(e).type;
+            return type == SigType::Untyped ? SigType::I32 : type;
+        }
+    }, expr);
+}
+
+// Whether the integer literal `value` is representable in `type`
+static bool literal_fits(int64_t value, SigType type) {
+    if (type == SigType::Float) {
+        return true;
+    }
+    if (type == SigType::Bool) {
+        return value == 0 || value == 1;
+    }
+    if (!is_integer_type(type)) {
+        return false;
+    }
+    unsigned bits = type_bits(type);
+    if (is_signed_type(type)) {
+        return bits == 64 || (value >= -(int64_t{1} << (bits - 1)) && value < (int64_t{1} << (bits - 1)));
+    }
+    return value >= 0 && (bits == 64 || value < (int64_t{1} << bits));
+}
+
+// Type of an integer literal that cannot adapt to `other`: i32 if it fits,
+// else i64, which also holds negative values next to a narrower unsigned
+static SigType literal_type(int64_t value, SigType other) {
+    if (literal_fits(value, SigType::I32) && !(value < 0 && other == SigType::U32)) {
+        return SigType::I32;
+    }
+    return SigType::I64;
+}
+
+// Bool mixes with integers as a one-bit unsigned value
+static std::optional<SigType> common_type(SigType left, std::optional<int64_t> left_literal,
+                                          SigType right, std::optional<int64_t> right_literal) {
+    if (left_literal && !right_literal) {
+        left = literal_fits(*left_literal, right) ? right : literal_type(*left_literal, right);
+    } else if (right_literal && !left_literal) {
+        right = literal_fits(*right_literal, left) ? left : literal_type(*right_literal, left);
+    }
+    if (left == right) {
+        return left == SigType::Pointer ? std::nullopt : std::optional<SigType>(left);
+    }
+
+    bool left_numeric = is_integer_type(left) || left == SigType::Bool || left == SigType::Float;
+    bool right_numeric = is_integer_type(right) || right == SigType::Bool || right == SigType::Float;
+    if (!left_numeric || !right_numeric) {
+        return std::nullopt;
+    }
+    if (left == SigType::Float || right == SigType::Float) {
+        if (left == SigType::Bool || right == SigType::Bool) {
+            return std::nullopt;
+        }
+        return SigType::Float;
+    }
+    unsigned left_bits = type_bits(left);
+    unsigned right_bits = type_bits(right);
+    if (left_bits != right_bits) {
+        return left_bits > right_bits ? left : right;
+    }
+    return is_signed_type(left) ? right : left;
+}
+
+std::optional<OperatorTyping> type_binary(SigBinaryOperator op, SigType left, std::optional<int64_t> left_literal,
+                                          SigType right, std::optional<int64_t> right_literal) {
+    if (left == SigType::String || right == SigType::String || is_array_type(left) || is_array_type(right) ||
+        left == SigType::Struct || right == SigType::Struct) {
+        return std::nullopt;
+    }
+
+    switch (op) {
+        case SigBinaryOperator::And:
+        case SigBinaryOperator::Or:
+            return OperatorTyping{SigType::Bool, SigType::Bool};
+
+        case SigBinaryOperator::LeftShift:
+        case SigBinaryOperator::RightShift: {
+            if (!is_integer_type(left) && left != SigType::Bool) return std::nullopt;
+            if (!is_integer_type(right) && right != SigType::Bool) return std::nullopt;
+            SigType operand = left == SigType::Bool ? SigType::I32 : left;
+            return OperatorTyping{operand, operand};
+        }
+
+        default:
+            break;
+    }
+
+    std::optional<SigType> common = common_type(left, left_literal, right, right_literal);
+    if (!common) {
+        return std::nullopt;
+    }
+
+    switch (op) {
+        case SigBinaryOperator::Equal:
+        case SigBinaryOperator::NotEqual:
+            return OperatorTyping{*common, SigType::Bool};
+        case SigBinaryOperator::LessThan:
+        case SigBinaryOperator::LessThanEqual:
+        case SigBinaryOperator::GreaterThan:
+        case SigBinaryOperator::GreaterThanEqual:
+            return OperatorTyping{*common == SigType::Bool ? SigType::I32 : *common, SigType::Bool};
+        case SigBinaryOperator::BitwiseAnd:
+        case SigBinaryOperator::BitwiseOr:
+        case SigBinaryOperator::BitwiseXor:
+            if (*common == SigType::Float) return std::nullopt;
+            return OperatorTyping{*common, *common};
+        case SigBinaryOperator::Not:
+            return std::nullopt;
+        default: {
+            // Arithmetic on bools counts them as integers
+            SigType operand = *common == SigType::Bool ? SigType::I32 : *common;
+            return OperatorTyping{operand, operand};
+        }
+    }
+}
+
+static std::optional<int64_t> literal_value(const Expression& expr) {
+    if (auto* value = std::get_if<int>(&expr)) {
+        return *value;
+    }
+    return std::nullopt;
+}
+
+std::optional<OperatorTyping> type_binary(const AstArena& arena, SigBinaryOperator op,
+                                          const Expression& left, const Expression& right) {
+    return type_binary(op, expression_type(arena, left), literal_value(left),
+                       expression_type(arena, right), literal_value(right));
+}
+
+std::optional<OperatorTyping> type_unary(const AstArena& arena, SigBinaryOperator op, const Expression& operand) {
+    SigType type = expression_type(arena, operand);
+    if (op != SigBinaryOperator::Not || type == SigType::String || is_array_type(type) || type == SigType::Struct) {
+        return std::nullopt;
+    }
+    return OperatorTyping{SigType::Bool, SigType::Bool};
+}
+
+constexpr BuiltinSignature builtin_signatures[] = {
+    {"abs", 1, true, true},
+    {"sqrt", 1, true, false},
+    {"max", 2, true, true},
+    {"min", 2, true, true},
+    {"floor", 1, true, false},
+    {"ceil", 1, true, false},
+    {"fma", 3, true, false},
+    {"pow", 2, true, false},
+    {"popcount", 1, false, true},
+    {"ctz", 1, false, true},
+    {"clz", 1, false, true},
+    {"bswap", 1, false, true},
+    {"rotate", 2, false, true},
+};
+
+const BuiltinSignature* find_builtin(std::string_view name) {
+    for (const BuiltinSignature& builtin : builtin_signatures) {
+        if (builtin.name == name) {
+            return &builtin;
+        }
+    }
+    return nullptr;
+}
+
+std::optional<OperatorTyping> type_builtin(const AstArena& arena, const BuiltinSignature& builtin,
+                                           std::span<const Expression> arguments) {
+    if (arguments.size() != builtin.arity) {
+        return std::nullopt;
+    }
+    bool all_integer = std::all_of(arguments.begin(), arguments.end(), [&](const Expression& argument) {
+        return is_integer_type(expression_type(arena, argument));
+    });
+    if (all_integer && builtin.integer_form) {
+        SigType operand = expression_type(arena, arguments[0]);
+        if (arguments.size() == 2 && builtin.name != "rotate") {
+            auto typing = type_binary(arena, SigBinaryOperator::Add, arguments[0], arguments[1]);
+            if (!typing) {
+                return std::nullopt;
+            }
+            operand = typing->operand;
+        }
+        return OperatorTyping{operand, operand};
+    }
+
+    if (!builtin.float_form) {
+        return std::nullopt;
+    }
+    for (const Expression& argument : arguments) {
+        SigType type = expression_type(arena, argument);
+        if (!is_integer_type(type) && type != SigType::Float) {
+            return std::nullopt;
+        }
+    }
+    return OperatorTyping{SigType::Float, SigType::Float};
+}
+
+namespace {
+
+const char* operator_spelling(SigBinaryOperator op) {
+    switch (op) {
+        case SigBinaryOperator::Add: return "+";
+        case SigBinaryOperator::Subtract: return "-";
+        case SigBinaryOperator::Multiply: return "*";
+        case SigBinaryOperator::Divide: return "/";
+        case SigBinaryOperator::Modulo: return "%";
+        case SigBinaryOperator::Equal: return "==";
+        case SigBinaryOperator::NotEqual: return "!=";
+        case SigBinaryOperator::LessThan: return "<";
+        case SigBinaryOperator::LessThanEqual: return "<=";
+        case SigBinaryOperator::GreaterThan: return ">";
+        case SigBinaryOperator::GreaterThanEqual: return ">=";
+        case SigBinaryOperator::And: return "&&";
+        case SigBinaryOperator::Or: return "||";
+        case SigBinaryOperator::Not: return "!";
+        case SigBinaryOperator::BitwiseAnd: return "&";
+        case SigBinaryOperator::BitwiseOr: return "|";
+        case SigBinaryOperator::BitwiseXor: return "^";
+        case SigBinaryOperator::LeftShift: return "<<";
+        case SigBinaryOperator::RightShift: return ">>";
+    }
+    return "?";
+}
+
+// Scalars that convert into one another and can be array elements
+bool is_number(SigType type) {
+    return is_integer_type(type) || type == SigType::Bool || type == SigType::Float;
+}
+
+// A variable's type, with the element type and length of an array or
+// slice, and the struct of a struct or of its elements
+struct Binding {
+    SigType type = SigType::I32;
+    ArrayShape array{};
+};
+
+// Walks statements in source order with the variables in scope, scoped the
+// same way codegen allocates them: every block is a scope, a function body
+// sees only its parameters and its own locals, and a for counter lives for
+// its loop.
+class TypeInference {
+private:
+    AstArena& arena;
+    ScopedTable<Binding> variables;
+    // Structs and the parameters of functions defined so far, by name
+    std::unordered_map<Symbol, const StructDefinition*, SymbolHash> structs;
+    std::unordered_map<Symbol, Range<TypedName>, SymbolHash> functions;
+    unsigned block_depth = 0;
+    bool ok = true;
+
+    const std::string& name(Symbol symbol) const { return arena.symbols.name(symbol); }
+
+    std::string describe(const Binding& binding) const {
+        std::string element = binding.array.element == SigType::Struct ? name(binding.array.record)
+                                                                        : type_name(binding.array.element);
+        if (binding.type == SigType::Array) {
+            return "[" + std::to_string(binding.array.length) + "]" + element;
+        } else if (binding.type == SigType::Slice) {
+            return "[]" + element;
+        } else if (binding.type == SigType::Struct) {
+            return name(binding.array.record);
+        }
+        return type_name(binding.type);
+    }
+
+    void error(const std::string& message) {
+        std::cerr << "Type error: " << message << std::endl;
+        ok = false;
+    }
+
+    void infer(const Expression& expr) {
+        auto* ref = std::get_if<ExprRef>(&expr);
+        if (!ref) {
+            return;
+        }
+        // Only types are written below, so the pool does not move
+        ExprNode& node = arena.expression(*ref);
+        switch (node.kind) {
+            case ExprKind::Variable: {
+                if (const Binding* found = variables.find(node.name)) {
+                    node.type = found->type;
+                    node.operand_type = is_array_type(found->type) ? found->array.element : found->type;
+                } else {
+                    error("Undefined variable '" + name(node.name) + "'");
+                    node.type = SigType::I32;
+                    node.operand_type = SigType::I32;
+                }
+                break;
+            }
+            case ExprKind::Unary: {
+                infer(node.left);
+                auto typing = type_unary(arena, node.op, node.left);
+                if (!typing) {
+                    error(std::string("Operator ") + operator_spelling(node.op) + " cannot be applied to " +
+                          type_name(expression_type(arena, node.left)));
+                    typing = OperatorTyping{SigType::Bool, SigType::Bool};
+                }
+                node.operand_type = typing->operand;
+                node.type = typing->result;
+                break;
+            }
+            case ExprKind::Binary: {
+                infer(node.left);
+                infer(node.right);
+                node.operand_type = check_binary(node.op, node.left, node.right, node.type);
+                break;
+            }
+            case ExprKind::Index: {
+                infer(node.left);
+                const Binding* array = array_variable(node.name);
+                check_index(node.left, node.name, array, false);
+                node.type = array ? array->array.element : SigType::I32;
+                node.operand_type = node.type;
+                break;
+            }
+            case ExprKind::Slice: {
+                infer(node.left);
+                infer(node.right);
+                const Binding* array = array_variable(node.name);
+                check_index(node.left, node.name, array, true);
+                check_index(node.right, node.name, array, true);
+                auto start = literal_value(node.left);
+                auto end = literal_value(node.right);
+                if (start && end && *start > *end) {
+                    error("Slice start " + std::to_string(*start) + " is past its end " + std::to_string(*end));
+                }
+                node.type = SigType::Slice;
+                node.operand_type = array ? array->array.element : SigType::I32;
+                break;
+            }
+            case ExprKind::Length: {
+                const Binding* found = variables.find(node.name);
+                if (!found || found->type != SigType::String) {
+                    array_variable(node.name);
+                }
+                node.type = SigType::I64;
+                node.operand_type = SigType::I64;
+                break;
+            }
+            case ExprKind::ArrayLiteral:
+                node.type = SigType::Array;
+                node.operand_type = infer_elements(node.elements);
+                break;
+            case ExprKind::Field:
+            case ExprKind::ElementField: {
+                bool element = node.kind == ExprKind::ElementField;
+                if (element) {
+                    infer(node.left);
+                    check_index(node.left, node.name, variables.find(node.name), false);
+                }
+                auto record = struct_of(node.name, element);
+                const TypedName* field = record ? field_of(*record, node.field) : nullptr;
+                node.type = field ? field->type : SigType::I32;
+                node.operand_type = node.type;
+                break;
+            }
+            case ExprKind::StructLiteral:
+                check_struct_literal(node);
+                node.type = SigType::Struct;
+                node.operand_type = SigType::Struct;
+                break;
+            case ExprKind::Call: {
+                auto arguments = arena.list(node.elements);
+                for (const Expression& argument : arguments) {
+                    infer(argument);
+                }
+                OperatorTyping typing = check_call(node.name, arguments);
+                node.type = typing.result;
+                node.operand_type = typing.operand;
+                break;
+            }
+        }
+    }
+
+    // A call inside an expression, which needs a result: a builtin, or len
+    // of a string
+    OperatorTyping check_call(Symbol function, std::span<const Expression> arguments) {
+        if (functions.count(function)) {
+            error("'" + name(function) + "' returns no value and cannot be called inside an expression");
+            return OperatorTyping{SigType::I32, SigType::I32};
+        }
+        if (name(function) == "len") {
+            if (arguments.size() != 1 || expression_type(arena, arguments[0]) != SigType::String) {
+                error("len expects a string or the name of an array or slice");
+            }
+            return OperatorTyping{SigType::String, SigType::I64};
+        }
+        const BuiltinSignature* builtin = find_builtin(name(function));
+        if (!builtin) {
+            error("Unknown function '" + name(function) + "'");
+            return OperatorTyping{SigType::I32, SigType::I32};
+        }
+        return check_builtin(*builtin, arguments);
+    }
+
+    OperatorTyping check_builtin(const BuiltinSignature& builtin, std::span<const Expression> arguments) {
+        if (auto typing = type_builtin(arena, builtin, arguments)) {
+            return *typing;
+        }
+        std::string builtin_name(builtin.name);
+        if (arguments.size() != builtin.arity) {
+            error(builtin_name + " expects " + std::to_string(builtin.arity) + " argument(s), got " +
+                  std::to_string(arguments.size()));
+        } else {
+            error(builtin_name + (builtin.float_form ? " expects numeric arguments" : " expects integer arguments"));
+        }
+        SigType fallback = builtin.float_form ? SigType::Float : SigType::I32;
+        return OperatorTyping{fallback, fallback};
+    }
+
+    // The struct named `record`; unknown names are reported
+    const StructDefinition* struct_named(Symbol record) {
+        auto found = structs.find(record);
+        if (found == structs.end()) {
+            error("Unknown struct '" + name(record) + "'");
+            return nullptr;
+        }
+        return found->second;
+    }
+
+    const TypedName* field_of(Symbol record, Symbol field) {
+        const StructDefinition* definition = struct_named(record);
+        if (!definition) {
+            return nullptr;
+        }
+        for (const TypedName& candidate : arena.list(definition->fields)) {
+            if (candidate.name == field) {
+                return &candidate;
+            }
+        }
+        error("Struct '" + name(record) + "' has no field '" + name(field) + "'");
+        return nullptr;
+    }
+
+    // The struct of variable `var`, or of its elements when `element` is
+    // set; anything else is reported
+    std::optional<Symbol> struct_of(Symbol var, bool element) {
+        const Binding* found = element ? array_variable(var) : variables.find(var);
+        if (!found) {
+            if (!element) {
+                error("Undefined variable '" + name(var) + "'");
+            }
+            return std::nullopt;
+        }
+        SigType type = element ? found->array.element : found->type;
+        if (type != SigType::Struct) {
+            error(element ? "Elements of '" + name(var) + "' are " + type_name(type) + ", not structs"
+                          : "'" + name(var) + "' has type " + describe(*found) + ", not a struct");
+            return std::nullopt;
+        }
+        return found->array.record;
+    }
+
+    // An annotation may only name a struct that exists
+    void check_binding(const Binding& binding) {
+        if (binding.type == SigType::Struct ||
+            (is_array_type(binding.type) && binding.array.element == SigType::Struct)) {
+            struct_named(binding.array.record);
+        }
+    }
+
+    // Each field named once, with a number that fits it; fields left out
+    // are zero
+    void check_struct_literal(const ExprNode& node) {
+        const StructDefinition* definition = struct_named(node.name);
+        auto fields = arena.list(node.fields);
+        auto values = arena.list(node.elements);
+        for (size_t i = 0; i < values.size(); ++i) {
+            infer(values[i]);
+            if (std::find(fields.begin(), fields.begin() + i, fields[i]) != fields.begin() + i) {
+                error("Field '" + name(fields[i]) + "' is given twice in a " + name(node.name) + " literal");
+            }
+            SigType type = expression_type(arena, values[i]);
+            if (!is_number(type)) {
+                error(std::string("Struct fields hold numbers or bools, not ") + type_name(type));
+            } else if (const TypedName* field = definition ? field_of(node.name, fields[i]) : nullptr) {
+                check_field_value(values[i], *field);
+            }
+        }
+    }
+
+    void check_field_value(const Expression& value, const TypedName& field) {
+        auto literal = literal_value(value);
+        if (literal && !literal_fits(*literal, field.type)) {
+            error("Value " + std::to_string(*literal) + " does not fit in field '" + name(field.name) + "' of type " +
+                  type_name(field.type));
+        }
+    }
+
+    // The struct of a struct-valued expression: a struct variable, an
+    // element of an array of structs, or a struct literal
+    std::optional<Symbol> struct_value(const Expression& expr) {
+        auto* ref = std::get_if<ExprRef>(&expr);
+        if (!ref || arena.expression(*ref).type != SigType::Struct) {
+            return std::nullopt;
+        }
+        const ExprNode& node = arena.expression(*ref);
+        if (node.kind == ExprKind::StructLiteral) {
+            return node.name;
+        }
+        const Binding* found = variables.find(node.name);
+        return found ? std::optional<Symbol>(found->array.record) : std::nullopt;
+    }
+
+    bool is_struct_value(const Expression& expr, Symbol record) {
+        auto found = struct_value(expr);
+        return found && *found == record;
+    }
+
+    // The type a variable assigned `value` without an annotation takes
+    Binding value_binding(const Expression& value) {
+        if (auto array = array_value(value)) {
+            return *array;
+        }
+        if (auto record = struct_value(value)) {
+            return Binding{SigType::Struct, ArrayShape{SigType::I32, 0, *record}};
+        }
+        return Binding{expression_type(arena, value)};
+    }
+
+    // The array or slice `array` names; anything else is reported
+    const Binding* array_variable(Symbol array) {
+        const Binding* found = variables.find(array);
+        if (!found) {
+            error("Undefined variable '" + name(array) + "'");
+            return nullptr;
+        }
+        if (!is_array_type(found->type)) {
+            error("'" + name(array) + "' has type " + type_name(found->type) + ", not an array or slice");
+            return nullptr;
+        }
+        return found;
+    }
+
+    // Indices are integers. A literal index into an array must be below
+    // its length; a slice bound may also equal it.
+    void check_index(const Expression& index, Symbol array_name, const Binding* array, bool slice_bound) {
+        SigType type = expression_type(arena, index);
+        if (!is_integer_type(type)) {
+            error(std::string("Array index must be an integer, not ") + type_name(type));
+            return;
+        }
+        auto value = literal_value(index);
+        if (value && array && array->type == SigType::Array) {
+            int64_t limit = int64_t{array->array.length} + (slice_bound ? 1 : 0);
+            if (*value < 0 || *value >= limit) {
+                error("Index " + std::to_string(*value) + " is out of bounds for '" + name(array_name) + "' of type " +
+                      describe(*array));
+            }
+        }
+    }
+
+    // Element type of an array literal: the common type of its elements,
+    // with integer literals adapting as they do for operators
+    SigType infer_elements(Range<Expression> elements) {
+        SigType element = SigType::Untyped;
+        for (const Expression& value : arena.list(elements)) {
+            infer(value);
+            SigType type = expression_type(arena, value);
+            if (!is_number(type)) {
+                error(std::string("Array elements must be numbers or bools, not ") + type_name(type));
+                continue;
+            }
+            if (literal_value(value)) {
+                continue;
+            }
+            if (element == SigType::Untyped) {
+                element = type;
+            } else if (auto typing = type_binary(SigBinaryOperator::Equal, element, std::nullopt, type, std::nullopt)) {
+                element = typing->operand;
+            } else {
+                error(std::string("Array elements of type ") + type_name(element) + " and " + type_name(type) +
+                      " cannot be mixed");
+            }
+        }
+        for (const Expression& value : arena.list(elements)) {
+            auto literal = literal_value(value);
+            if (!literal) {
+                continue;
+            }
+            if (element == SigType::Untyped) {
+                element = SigType::I32;
+            } else if (!literal_fits(*literal, element)) {
+                element = type_binary(SigBinaryOperator::Equal, element, std::nullopt, SigType::I32, literal)->operand;
+            }
+        }
+        return element;
+    }
+
+    // Type of an array-valued expression: an array or slice variable, a
+    // slice, or an array literal
+    std::optional<Binding> array_value(const Expression& expr) {
+        auto* ref = std::get_if<ExprRef>(&expr);
+        if (!ref) {
+            return std::nullopt;
+        }
+        const ExprNode& node = arena.expression(*ref);
+        switch (node.kind) {
+            case ExprKind::Variable:
+                if (const Binding* found = variables.find(node.name); found && is_array_type(found->type)) {
+                    return *found;
+                }
+                return std::nullopt;
+            case ExprKind::Slice:
+                if (const Binding* found = variables.find(node.name); found && is_array_type(found->type)) {
+                    return Binding{SigType::Slice, ArrayShape{node.operand_type, 0, found->array.record}};
+                }
+                return Binding{SigType::Slice, ArrayShape{node.operand_type, 0}};
+            case ExprKind::ArrayLiteral:
+                return Binding{SigType::Array, ArrayShape{node.operand_type, node.elements.count}};
+            default:
+                return std::nullopt;
+        }
+    }
+
+    // An array takes a literal of its length, whose elements convert to its
+    // element type, or a copy of an array of the same type. A slice views
+    // an array or another slice of the same element type.
+    void check_array_assignment(Symbol var, const Binding& target, const Expression& value) {
+        auto source = array_value(value);
+        if (!source || !is_array_type(target.type)) {
+            Binding shown = source ? *source : Binding{expression_type(arena, value)};
+            error("Cannot assign a " + describe(shown) + " to '" + name(var) + "' of type " + describe(target));
+            return;
+        }
+
+        ExprNode& node = arena.expression(std::get<ExprRef>(value));
+        if (node.kind == ExprKind::ArrayLiteral && target.array.element == SigType::Struct) {
+            error("'" + name(var) + "' holds structs and cannot be set from an array literal; assign its elements");
+            return;
+        }
+        if (target.type == SigType::Array && node.kind == ExprKind::ArrayLiteral) {
+            if (node.elements.count != target.array.length) {
+                error("Cannot assign " + std::to_string(node.elements.count) + " elements to '" + name(var) +
+                      "' of type " + describe(target));
+            }
+            for (const Expression& element : arena.list(node.elements)) {
+                check_element_literal(element, target.array.element);
+            }
+            node.operand_type = target.array.element;
+            return;
+        }
+        if (target.type == SigType::Slice && node.kind == ExprKind::ArrayLiteral) {
+            error("A slice views an existing array; declare the array first and assign it to '" + name(var) + "'");
+            return;
+        }
+        bool same_shape = target.type == SigType::Slice || (source->type == SigType::Array &&
+                                                            source->array.length == target.array.length);
+        bool same_element = source->array.element == target.array.element &&
+                            (target.array.element != SigType::Struct || source->array.record == target.array.record);
+        if (!same_shape || !same_element) {
+            error("Cannot assign a " + describe(*source) + " to '" + name(var) + "' of type " + describe(target));
+        }
+    }
+
+    void check_element_literal(const Expression& value, SigType element) {
+        auto literal = literal_value(value);
+        if (literal && !literal_fits(*literal, element)) {
+            error("Value " + std::to_string(*literal) + " does not fit in an element of type " + type_name(element));
+        }
+    }
+
+    // Returns the operand type and sets `result`
+    SigType check_binary(SigBinaryOperator op, const Expression& left, const Expression& right, SigType& result) {
+        auto typing = type_binary(arena, op, left, right);
+        if (!typing) {
+            error(std::string("Operator ") + operator_spelling(op) + " cannot be applied to " +
+                  type_name(expression_type(arena, left)) + " and " + type_name(expression_type(arena, right)));
+            typing = OperatorTyping{SigType::I32, SigType::I32};
+        }
+        result = typing->result;
+        return typing->operand;
+    }
+
+    // An if, elif or while condition converts to bool like any number
+    void check_condition(const Expression& condition) {
+        infer(condition);
+        SigType type = expression_type(arena, condition);
+        if (!is_number(type)) {
+            error(std::string("A ") + type_name(type) + " cannot be a condition");
+        }
+    }
+
+    SigType check_loop_bound(const Expression& bound) {
+        infer(bound);
+        SigType type = expression_type(arena, bound);
+        if (!is_integer_type(type)) {
+            error(std::string("For loop bounds must be integers, not ") + type_name(type));
+            return SigType::I32;
+        }
+        return type;
+    }
+
+    void check_printable(SigType type) {
+        if (is_array_type(type)) {
+            error(std::string("Cannot print a whole ") + type_name(type) + "; print its elements");
+        } else if (type == SigType::Struct) {
+            error("Cannot print a whole struct; print its fields");
+        }
+    }
+
+    void check_block(Range<NodeRef> block) {
+        variables.push_scope();
+        ++block_depth;
+        for (NodeRef stmt : arena.list(block)) {
+            check_statement(stmt);
+        }
+        --block_depth;
+        variables.pop_scope();
+    }
+
+public:
+    explicit TypeInference(AstArena& arena) : arena(arena) {}
+
+    // Makes a top-level struct known to the whole program, so it may be
+    // used above its definition
+    void define_struct(const StructDefinition& s) {
+        if (!structs.try_emplace(s.name, &s).second) {
+            error("Struct '" + name(s.name) + "' is defined twice");
+            return;
+        }
+        auto fields = arena.list(s.fields);
+        for (size_t i = 0; i < fields.size(); ++i) {
+            for (size_t j = 0; j < i; ++j) {
+                if (fields[j].name == fields[i].name) {
+                    error("Struct '" + name(s.name) + "' has two fields named '" + name(fields[i].name) + "'");
+                }
+            }
+        }
+    }
+
+    bool succeeded() const { return ok; }
+
+    void check_statement(NodeRef stmt) {
+        arena.visit(stmt, [this](const auto& s) {
+            using T = std::decay_t<decltype(s)>;
+
+            if constexpr (std::is_same_v<T, PrintStatement> || std::is_same_v<T, PrintlnStatement>) {
+                infer(s.value);
+                check_printable(expression_type(arena, s.value));
+            }
+            else if constexpr (std::is_same_v<T, PrintVariable>) {
+                if (const Binding* found = variables.find(s.variableName)) {
+                    check_printable(found->type);
+                } else {
+                    error("Undefined variable '" + name(s.variableName) + "'");
+                }
+            }
+            else if constexpr (std::is_same_v<T, VariableDeclaration>) {
+                Binding binding{s.type.value_or(SigType::I32), s.array};
+                check_binding(binding);
+                variables.bind(s.var_name, binding);
+            }
+            else if constexpr (std::is_same_v<T, VariableAssignment>) {
+                infer(s.value);
+                SigType value_type = expression_type(arena, s.value);
+                // Assigning to a variable in scope keeps its type; a new one
+                // takes its annotation or else the value's type
+                Binding var;
+                if (const Binding* found = variables.find(s.var_name)) {
+                    var = *found;
+                } else if (s.type) {
+                    var = variables.bind(s.var_name, Binding{*s.type, s.array});
+                    check_binding(var);
+                } else {
+                    var = variables.bind(s.var_name, value_binding(s.value));
+                }
+                if (is_array_type(var.type) || is_array_type(value_type)) {
+                    check_array_assignment(s.var_name, var, s.value);
+                } else if (var.type == SigType::Struct || value_type == SigType::Struct) {
+                    // Structs are copied whole, from a struct of the same type
+                    if (var.type != SigType::Struct || !is_struct_value(s.value, var.array.record)) {
+                        error("Cannot assign a " + describe(value_binding(s.value)) + " to '" + name(s.var_name) +
+                              "' of type " + describe(var));
+                    }
+                } else if ((value_type == SigType::String) != (var.type == SigType::String)) {
+                    error("Cannot assign a " + std::string(type_name(value_type)) + " to '" + name(s.var_name) +
+                          "' of type " + type_name(var.type));
+                }
+            }
+            else if constexpr (std::is_same_v<T, IndexAssignment>) {
+                infer(s.index);
+                infer(s.value);
+                const Binding* array = array_variable(s.array);
+                check_index(s.index, s.array, array, false);
+                SigType value_type = expression_type(arena, s.value);
+                if (array && array->array.element == SigType::Struct) {
+                    if (!is_struct_value(s.value, array->array.record)) {
+                        error("Cannot store a " + describe(value_binding(s.value)) + " in an element of '" +
+                              name(s.array) + "' of type " + describe(*array));
+                    }
+                } else if (!is_number(value_type)) {
+                    error(std::string("Cannot store a ") + type_name(value_type) + " in an element of '" +
+                          name(s.array) + "'");
+                } else if (array) {
+                    check_element_literal(s.value, array->array.element);
+                }
+            }
+            else if constexpr (std::is_same_v<T, FieldAssignment>) {
+                infer(s.value);
+                if (s.index) {
+                    infer(*s.index);
+                    check_index(*s.index, s.target, variables.find(s.target), false);
+                }
+                auto record = struct_of(s.target, s.index.has_value());
+                const TypedName* field = record ? field_of(*record, s.field) : nullptr;
+                SigType value_type = expression_type(arena, s.value);
+                if (!is_number(value_type)) {
+                    error(std::string("Cannot store a ") + type_name(value_type) + " in field '" + name(s.field) + "'");
+                } else if (field) {
+                    check_field_value(s.value, *field);
+                }
+            }
+            else if constexpr (std::is_same_v<T, StructDefinition>) {
+                // Top-level structs were registered before the walk
+                if (block_depth > 0) {
+                    error("Struct '" + name(s.name) + "' must be defined at the top level");
+                }
+            }
+            else if constexpr (std::is_same_v<T, FunctionDefinition>) {
+                functions[s.name] = s.params;
+                variables.push_function_scope();
+                for (const TypedName& param : arena.list(s.params)) {
+                    Binding binding{param.type, ArrayShape{SigType::I32, 0, param.record}};
+                    check_binding(binding);
+                    variables.bind(param.name, binding);
+                }
+                check_block(s.body);
+                variables.pop_function_scope();
+            }
+            else if constexpr (std::is_same_v<T, FunctionCall>) {
+                // A struct argument needs a struct parameter of its type
+                auto callee = functions.find(s.function_name);
+                auto params = callee != functions.end() ? arena.list(callee->second) : std::span<const TypedName>{};
+                auto arguments = arena.list(s.arguments);
+                for (size_t i = 0; i < arguments.size(); ++i) {
+                    infer(arguments[i]);
+                    SigType type = expression_type(arena, arguments[i]);
+                    bool struct_param = i < params.size() && params[i].type == SigType::Struct;
+                    if (is_array_type(type)) {
+                        error("Arrays and slices cannot be passed to '" + name(s.function_name) + "'");
+                    } else if (struct_param && !is_struct_value(arguments[i], params[i].record)) {
+                        error("Cannot pass a " + describe(value_binding(arguments[i])) + " to parameter '" +
+                              name(params[i].name) + "' of '" + name(s.function_name) + "', which is a " +
+                              name(params[i].record));
+                    } else if (!struct_param && type == SigType::Struct) {
+                        error("'" + name(s.function_name) + "' does not take a struct as argument " +
+                              std::to_string(i + 1));
+                    }
+                }
+                // User functions shadow the builtins
+                const BuiltinSignature* builtin =
+                    callee == functions.end() ? find_builtin(name(s.function_name)) : nullptr;
+                if (builtin) {
+                    check_builtin(*builtin, arguments);
+                }
+            }
+            else if constexpr (std::is_same_v<T, BinaryExpression>) {
+                infer(s.left);
+                infer(s.right);
+                SigType result;
+                check_binary(s.operator_type, s.left, s.right, result);
+            }
+            else if constexpr (std::is_same_v<T, UnaryExpression>) {
+                infer(s.operand);
+                if (!type_unary(arena, s.operator_type, s.operand)) {
+                    error(std::string("Operator ") + operator_spelling(s.operator_type) + " cannot be applied to " +
+                          type_name(expression_type(arena, s.operand)));
+                }
+            }
+            else if constexpr (std::is_same_v<T, IfStatement>) {
+                check_condition(s.condition);
+                check_block(s.thenBlock);
+                for (const ElifClause& clause : arena.list(s.elifClauses)) {
+                    check_condition(clause.condition);
+                    check_block(clause.block);
+                }
+                if (s.elseBlock) {
+                    check_block(*s.elseBlock);
+                }
+            }
+            else if constexpr (std::is_same_v<T, WhileStatement>) {
+                check_condition(s.condition);
+                check_block(s.body);
+            }
+            else if constexpr (std::is_same_v<T, ForStatement>) {
+                // The counter is as wide as the wider bound, at least 32 bits
+                SigType start = check_loop_bound(s.start);
+                SigType end = check_loop_bound(s.end);
+                bool wide = type_bits(start) == 64 || type_bits(end) == 64;
+                variables.push_scope();
+                variables.bind(s.initialization, Binding{wide ? SigType::I64 : SigType::I32});
+                check_block(s.body);
+                variables.pop_scope();
+            }
+        });
+    }
+};
+
+}  // namespace
+
+bool infer_types(AstArena& arena, const AST& program) {
+    TypeInference inference(arena);
+    for (NodeRef stmt : program) {
+        if (arena.holds<StructDefinition>(stmt)) {
+            inference.define_struct(arena.get<StructDefinition>(stmt));
+        }
+    }
+    for (NodeRef stmt : program) {
+        inference.check_statement(stmt);
+    }
+    return inference.succeeded();
+}
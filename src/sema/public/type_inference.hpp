@@ -0,0 +1,60 @@
+#pragma once
+#include <ast/public/ast_simple.hpp>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Integer types are u8..u64 and i8..i64; Untyped counts as i32
+bool is_integer_type(SigType type);
+bool is_signed_type(SigType type);
+bool is_array_type(SigType type);  // Array or Slice
+unsigned type_bits(SigType type);
+const char* type_name(SigType type);
+
+// Type of an expression whose nodes have been through infer_types(). A
+// plain integer literal is i32, a Symbol a string, an array literal or
+// array variable Array.
+SigType expression_type(const AstArena& arena, const Expression& expr);
+
+// Type both operands of an operator are converted to, and the type of its
+// result
+struct OperatorTyping {
+    SigType operand;
+    SigType result;
+};
+
+// Typing rules shared by inference and codegen. An integer literal takes
+// the type of the other operand when its value fits; otherwise floats win
+// over integers, wider integers over narrower ones and unsigned over signed
+// of the same width. Comparisons and logical operators produce bool, and a
+// shift has the type of its left operand. nullopt if the operator does not
+// apply to these operand types, which includes every string, array and
+// slice.
+std::optional<OperatorTyping> type_binary(SigBinaryOperator op, SigType left, std::optional<int64_t> left_literal,
+                                          SigType right, std::optional<int64_t> right_literal);
+std::optional<OperatorTyping> type_binary(const AstArena& arena, SigBinaryOperator op,
+                                          const Expression& left, const Expression& right);
+std::optional<OperatorTyping> type_unary(const AstArena& arena, SigBinaryOperator op, const Expression& operand);
+
+// A math or bit builtin, lowered to an intrinsic by
+// CodeGen::codegen_builtin_call
+struct BuiltinSignature {
+    std::string_view name;
+    unsigned arity;
+    bool float_form;    // on f64, with integer arguments converted
+    bool integer_form;  // on all-integer arguments
+};
+const BuiltinSignature* find_builtin(std::string_view name);
+
+// Type a builtin's arguments are converted to, and the type of its
+// result. All-integer arguments meet at their common type, as for `+`,
+// when the builtin has an integer form; rotate keeps the type of the
+// value it rotates. Anything else takes the f64 form. nullopt if the
+// arguments do not fit the builtin.
+std::optional<OperatorTyping> type_builtin(const AstArena& arena, const BuiltinSignature& builtin,
+                                           std::span<const Expression> arguments);
+
+// Annotates every expression node reachable from `program` with its type.
+// Ill-typed expressions and undefined variables are reported to stderr;
+// returns false if there were any.
+bool infer_types(AstArena& arena, const AST& program);
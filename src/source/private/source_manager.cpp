@@ -0,0 +1,94 @@
+#include "../public/source_manager.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+SourceFile::SourceFile(std::string path) : file_path(std::move(path)) {}
+
+SourceFile::~SourceFile() {
+#ifndef _WIN32
+    if (mapped_data) {
+        munmap(const_cast<char*>(mapped_data), mapped_size);
+    }
+#endif
+}
+
+#ifndef _WIN32
+// Read everything from a descriptor that can't be mapped (pipe, FIFO, tty)
+static bool read_stream(int fd, std::string& out) {
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n == 0) return true;
+        if (n < 0) return false;
+        out.append(chunk, static_cast<size_t>(n));
+    }
+}
+#endif
+
+std::unique_ptr<SourceFile> SourceFile::open(const std::string& path) {
+    std::unique_ptr<SourceFile> file(new SourceFile(path));
+
+#ifndef _WIN32
+    if (path == "-") {
+        if (!read_stream(STDIN_FILENO, file->buffer)) return nullptr;
+        return file;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            // The lexer walks the file front to back exactly once
+            madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            file->mapped_data = static_cast<const char*>(mapping);
+            file->mapped_size = static_cast<size_t>(st.st_size);
+            close(fd);
+            return file;
+        }
+    }
+
+    bool ok = read_stream(fd, file->buffer);
+    close(fd);
+    if (!ok) return nullptr;
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return nullptr;
+    file->buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+#endif
+
+    return file;
+}
+
+const SourceFile* SourceManager::load(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files_by_path.find(path);
+    if (it != files_by_path.end()) {
+        return it->second;
+    }
+
+    auto file = SourceFile::open(path);
+    if (!file) {
+        return nullptr;
+    }
+
+    SourceFile* loaded = file.get();
+    files.push_back(std::move(file));
+    files_by_path.emplace(path, loaded);
+    return loaded;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <lexer/public/string_interner.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A loaded source file. Regular files are memory-mapped read-only; pipes,
+// stdin ("-") and empty files are read into an owned buffer instead.
+class SourceFile {
+private:
+    std::string file_path;
+    const char* mapped_data = nullptr;
+    size_t mapped_size = 0;
+    std::string buffer;
+
+    explicit SourceFile(std::string path);
+
+public:
+    ~SourceFile();
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    static std::unique_ptr<SourceFile> open(const std::string& path);
+
+    const std::string& path() const { return file_path; }
+    bool is_mapped() const { return mapped_data != nullptr; }
+    std::string_view text() const {
+        return mapped_data ? std::string_view(mapped_data, mapped_size) : std::string_view(buffer);
+    }
+};
+
+// Owns every source file loaded during a compilation, together with the
+// interned token text, so token views and diagnostics stay valid until the
+// compiler exits.
+class SourceManager {
+private:
+    std::vector<std::unique_ptr<SourceFile>> files;
+    std::unordered_map<std::string, SourceFile*> files_by_path;
+    StringInterner interner;
+    std::mutex mutex;
+
+public:
+    // Returns nullptr if the file cannot be opened. Safe to call from several
+    // threads; strings() is not.
+    const SourceFile* load(const std::string& path);
+    StringInterner& strings() { return interner; }
+};
@@ -0,0 +1,3 @@
+#pragma once
+
+inline constexpr const char* sig_version = "0.2.0-alpha";
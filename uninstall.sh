@@ -22,6 +22,11 @@ for dir in "${INSTALL_DIRS[@]}"; do
         if [ -w "$dir/sig" ]; then
             rm "$dir/sig"
             echo -e "${GREEN}Removed $dir/sig${NC}"
+            if [ -d "$dir/../lib/sig" ]; then
+                rm -f "$dir"/../lib/sig/libsig_runtime*.a "$dir/../lib/sig/sig_runtime.bc"
+                rmdir "$dir/../lib/sig" 2>/dev/null
+                echo -e "${GREEN}Removed the runtime from $dir/../lib/sig${NC}"
+            fi
             FOUND=true
         else
             echo -e "${RED}No write permission for $dir${NC}"